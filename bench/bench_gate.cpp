@@ -0,0 +1,208 @@
+#include "bench_gate.hpp"
+
+#include "cpu_dispatch.hpp"
+#include "frame_arena.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+namespace {
+
+// Phases that are gated; emit and write are too short to hold a threshold.
+const char *gatedPhases[] = {"simulate", "sort", "update", "total"};
+
+struct Metric {
+  double median = 0.0;
+  double low = 0.0;
+  double high = 0.0;
+};
+
+using MetricKey = std::pair<std::string, std::string>; // scenario, phase
+using MetricTable = std::map<MetricKey, Metric>;
+
+double binomialCdf(int n, int k) {
+  // P(X <= k) for X ~ Binomial(n, 1/2)
+  double sum = 0.0;
+  double coefficient = 1.0;
+  for (int i = 0; i <= k; ++i) {
+    sum += coefficient;
+    coefficient = coefficient * (n - i) / (i + 1);
+  }
+  return sum / std::pow(2.0, n);
+}
+
+// Median and a distribution-free ~95% interval around it from order
+// statistics. Five runs only support [min, max] (94%).
+Metric summarizeRuns(std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+  int n = static_cast<int>(values.size());
+  Metric metric;
+  metric.median = n % 2 ? values[n / 2]
+                        : 0.5 * (values[n / 2 - 1] + values[n / 2]);
+  int rank = 1;
+  while (rank < n / 2 && binomialCdf(n, rank) <= 0.025)
+    ++rank;
+  metric.low = values[rank - 1];
+  metric.high = values[n - rank];
+  return metric;
+}
+
+bool readBaseline(const std::string &path, MetricTable &table) {
+  std::ifstream file(path);
+  if (!file)
+    return false;
+  std::string line;
+  while (std::getline(file, line)) {
+    line = line.substr(0, line.find('#'));
+    std::istringstream fields(line);
+    MetricKey key;
+    Metric metric;
+    if (fields >> key.first >> key.second >> metric.median >> metric.low >>
+        metric.high)
+      table[key] = metric;
+  }
+  return true;
+}
+
+bool writeBaseline(const std::string &path, const GateOptions &options,
+                   const MetricTable &table) {
+  std::FILE *file = std::fopen(path.c_str(), "w");
+  if (!file)
+    return false;
+  std::fprintf(file,
+               "# particle_bench gate baseline, written by --update-baseline.\n"
+               "# CPU tier %s, %d runs per scenario. Timings are machine\n"
+               "# specific: refresh on the machine that runs the gate.\n"
+               "# scenario phase median_ms ci_low_ms ci_high_ms\n",
+               cpu::tierName(cpu::activeTier()), options.runs);
+  for (const auto &entry : table)
+    std::fprintf(file, "%s %s %.4f %.4f %.4f\n", entry.first.first.c_str(),
+                 entry.first.second.c_str(), entry.second.median,
+                 entry.second.low, entry.second.high);
+  std::fclose(file);
+  return true;
+}
+
+std::vector<std::string> scenarioFiles(const std::string &directory) {
+  std::vector<std::string> files;
+  std::error_code error;
+  for (const auto &entry :
+       std::filesystem::directory_iterator(directory, error))
+    if (entry.path().extension() == ".txt")
+      files.push_back(entry.path().string());
+  std::sort(files.begin(), files.end());
+  return files;
+}
+
+} // namespace
+
+int runGate(const GateOptions &options, const GateRunner &runner) {
+  MetricTable baseline;
+  if (!options.updateBaseline && !readBaseline(options.baselinePath, baseline)) {
+    std::cerr << "Cannot read baseline " << options.baselinePath
+              << " (create it with --update-baseline)" << std::endl;
+    return 2;
+  }
+
+  std::vector<std::string> files = scenarioFiles(options.scenarioDirectory);
+  if (files.empty()) {
+    std::cerr << "No gate scenarios in " << options.scenarioDirectory
+              << std::endl;
+    return 2;
+  }
+
+  std::vector<BenchScenario> scenarios(files.size());
+  for (std::size_t i = 0; i < files.size(); ++i) {
+    scenarios[i].name = std::filesystem::path(files[i]).stem().string();
+    if (!loadScenario(files[i], scenarios[i]))
+      return 2;
+  }
+
+  // Round robin over the scenarios rather than all runs of one in a row, so
+  // a slow drift of the machine (clocks, neighbours) widens the intervals
+  // instead of shifting a single scenario.
+  std::map<MetricKey, std::vector<double>> runs;
+  for (int run = 0; run < options.runs; ++run) {
+    for (const BenchScenario &scenario : scenarios) {
+      std::cerr << "gate: " << scenario.name << " run " << run + 1 << "/"
+                << options.runs << std::endl;
+      // Every run starts from an empty arena, whatever the previous one left.
+      FrameArena::local().reset();
+      for (const auto &phase : runner(scenario))
+        runs[{scenario.name, phase.first}].push_back(phase.second);
+    }
+  }
+
+  MetricTable current;
+  for (const BenchScenario &scenario : scenarios)
+    for (const char *phase : gatedPhases) {
+      const std::vector<double> &values = runs[{scenario.name, phase}];
+      if (!values.empty())
+        current[{scenario.name, phase}] = summarizeRuns(values);
+    }
+
+  if (options.updateBaseline) {
+    if (!writeBaseline(options.baselinePath, options, current)) {
+      std::cerr << "Cannot write baseline " << options.baselinePath
+                << std::endl;
+      return 2;
+    }
+    std::cout << "Wrote " << current.size() << " metrics to "
+              << options.baselinePath << std::endl;
+    return 0;
+  }
+
+  int regressions = 0;
+  std::printf("%-16s %-9s %12s %12s %8s  %-19s %-19s %s\n", "scenario",
+              "phase", "baseline_ms", "current_ms", "change", "baseline_ci",
+              "current_ci", "status");
+  for (const auto &entry : current) {
+    const Metric &now = entry.second;
+    auto found = baseline.find(entry.first);
+    if (found == baseline.end()) {
+      std::printf("%-16s %-9s %12s %12.4f %8s  %-19s [%.4f, %.4f] new\n",
+                  entry.first.first.c_str(), entry.first.second.c_str(), "-",
+                  now.median, "-", "-", now.low, now.high);
+      continue;
+    }
+    const Metric &before = found->second;
+    double change =
+        before.median > 0.0 ? now.median / before.median - 1.0 : 0.0;
+    const char *status = "ok";
+    if (change > options.threshold && now.low > before.high) {
+      status = "REGRESSED";
+      ++regressions;
+    } else if (change < -options.threshold && now.high < before.low) {
+      status = "improved";
+    } else if (std::fabs(change) > options.threshold) {
+      status = "noisy";
+    }
+    char beforeInterval[32], nowInterval[32];
+    std::snprintf(beforeInterval, sizeof(beforeInterval), "[%.4f, %.4f]",
+                  before.low, before.high);
+    std::snprintf(nowInterval, sizeof(nowInterval), "[%.4f, %.4f]", now.low,
+                  now.high);
+    std::printf("%-16s %-9s %12.4f %12.4f %+7.1f%%  %-19s %-19s %s\n",
+                entry.first.first.c_str(), entry.first.second.c_str(),
+                before.median, now.median, change * 100.0, beforeInterval,
+                nowInterval, status);
+  }
+  for (const auto &entry : baseline)
+    if (!current.count(entry.first))
+      std::printf("%-16s %-9s %12.4f %12s %8s  %-19s %-19s missing\n",
+                  entry.first.first.c_str(), entry.first.second.c_str(),
+                  entry.second.median, "-", "-", "-", "-");
+
+  if (regressions) {
+    std::printf("%d metric(s) regressed by more than %.1f%%\n", regressions,
+                options.threshold * 100.0);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,36 @@
+#ifndef BENCH_GATE_HPP
+#define BENCH_GATE_HPP
+
+#include "bench_scenario.hpp"
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Regression gate: every scenario of a fixed set runs several times, and the
+// median over the runs of each phase's median frame time is compared with
+// a baseline file. A metric regresses only when its median is past the
+// threshold and its confidence interval no longer overlaps the baseline's,
+// so run-to-run noise alone does not fail the gate.
+struct GateOptions {
+  std::string baselinePath;
+  // Every *.txt scenario in here, in name order.
+  std::string scenarioDirectory;
+  int runs = 5;
+  // Relative change of the median that counts, 0.05 = 5%.
+  double threshold = 0.05;
+  // Write the results as the new baseline instead of comparing.
+  bool updateBaseline = false;
+};
+
+// Median frame time in milliseconds of each phase of one run, by phase name.
+using GateRunner = std::function<std::vector<std::pair<std::string, double>>(
+    const BenchScenario &scenario)>;
+
+// Prints the per-metric table. Returns the process exit code: 0 when nothing
+// regressed or the baseline was written, 1 on a regression, 2 when the
+// baseline or the scenarios cannot be read.
+int runGate(const GateOptions &options, const GateRunner &runner);
+
+#endif // BENCH_GATE_HPP
@@ -0,0 +1,76 @@
+#include "bench_scenario.hpp"
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+bool parseFloat(const std::string &text, float &value) {
+  char *end = nullptr;
+  value = std::strtof(text.c_str(), &end);
+  return end && end != text.c_str() && *end == '\0';
+}
+
+std::string trim(const std::string &text) {
+  std::size_t first = text.find_first_not_of(" \t\r");
+  if (first == std::string::npos)
+    return "";
+  std::size_t last = text.find_last_not_of(" \t\r");
+  return text.substr(first, last - first + 1);
+}
+
+} // namespace
+
+bool setScenarioValue(BenchScenario &scenario, const std::string &key,
+                      const std::string &value) {
+  bool valid = true;
+  if (key == "name")
+    scenario.name = value;
+  else if (key == "warmup")
+    valid = parseFloat(value, scenario.warmup);
+  else if (key == "duration")
+    valid = parseFloat(value, scenario.duration);
+  else if (key == "dt")
+    valid = parseFloat(value, scenario.timeStep) && scenario.timeStep > 0.0f;
+  else
+    return setStressSceneValue(scenario.scene, key, value);
+
+  if (!valid)
+    std::cerr << "Bad value for " << key << ": " << value << std::endl;
+  return valid;
+}
+
+bool loadScenario(const std::string &path, BenchScenario &scenario) {
+  std::ifstream file(path);
+  if (!file) {
+    std::cerr << "Cannot open scenario " << path << std::endl;
+    return false;
+  }
+
+  std::string line;
+  int lineNumber = 0;
+  while (std::getline(file, line)) {
+    ++lineNumber;
+    line = trim(line.substr(0, line.find('#')));
+    if (line.empty())
+      continue;
+    std::size_t equals = line.find('=');
+    if (equals == std::string::npos) {
+      std::cerr << path << ":" << lineNumber << ": expected key = value"
+                << std::endl;
+      return false;
+    }
+    if (!setScenarioValue(scenario, trim(line.substr(0, equals)),
+                          trim(line.substr(equals + 1))))
+      return false;
+  }
+  return true;
+}
+
+const char *scenarioKeysHelp() {
+  return "  name <text>              label in the output\n"
+         "  warmup <s>               simulated, not measured\n"
+         "  duration <s>             simulated and measured\n"
+         "  dt <s>                   fixed time step\n";
+}
@@ -0,0 +1,29 @@
+#ifndef BENCH_SCENARIO_HPP
+#define BENCH_SCENARIO_HPP
+
+#include "stress_scene.hpp"
+
+#include <string>
+
+// One headless simulation run: a stress scene and how long to run it. Every
+// field can be set from a scenario file (key = value) or with --key value;
+// the keys are listed in scenarioKeysHelp() and stressSceneKeysHelp().
+struct BenchScenario {
+  std::string name = "default";
+  StressSceneConfig scene;
+
+  // Simulated seconds: warmup runs first and is not measured, so the pool
+  // can reach its steady size.
+  float warmup = 2.0f;
+  float duration = 10.0f;
+  float timeStep = 1.0f / 60.0f;
+};
+
+// False with a message on stderr for an unknown key or a bad value.
+bool setScenarioValue(BenchScenario &scenario, const std::string &key,
+                      const std::string &value);
+// Lines of key = value; '#' starts a comment.
+bool loadScenario(const std::string &path, BenchScenario &scenario);
+const char *scenarioKeysHelp();
+
+#endif // BENCH_SCENARIO_HPP
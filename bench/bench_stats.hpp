@@ -0,0 +1,51 @@
+#ifndef BENCH_STATS_HPP
+#define BENCH_STATS_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Summary of a set of samples, in the samples' unit. Percentiles are nearest
+// rank.
+struct SampleStats {
+  std::size_t count = 0;
+  double mean = 0.0;
+  double stddev = 0.0;
+  double min = 0.0;
+  double p50 = 0.0;
+  double p95 = 0.0;
+  double p99 = 0.0;
+  double max = 0.0;
+};
+
+inline SampleStats summarize(std::vector<double> samples) {
+  SampleStats stats;
+  stats.count = samples.size();
+  if (samples.empty())
+    return stats;
+
+  std::sort(samples.begin(), samples.end());
+  double sum = 0.0;
+  for (double sample : samples)
+    sum += sample;
+  stats.mean = sum / samples.size();
+  double squares = 0.0;
+  for (double sample : samples)
+    squares += (sample - stats.mean) * (sample - stats.mean);
+  stats.stddev = samples.size() > 1 ? std::sqrt(squares / (samples.size() - 1))
+                                    : 0.0;
+
+  auto rank = [&](double fraction) {
+    std::size_t index = static_cast<std::size_t>(
+        std::ceil(fraction * samples.size()));
+    return samples[std::min(samples.size() - 1, index ? index - 1 : 0)];
+  };
+  stats.min = samples.front();
+  stats.p50 = rank(0.50);
+  stats.p95 = rank(0.95);
+  stats.p99 = rank(0.99);
+  stats.max = samples.back();
+  return stats;
+}
+
+#endif // BENCH_STATS_HPP
@@ -0,0 +1,446 @@
+// Microbenchmarks of the hot pieces of the simulation, each timed on its own
+// over a sweep of particle counts: the update kernels and their Perlin port
+// per ISA tier (next to glm::perlin), cone sampling, the depth sort, the
+// emitter's slot search and building the per-particle draw records. Results
+// are CSV or JSON, one row per case, variant and count, with times per
+// iteration in nanoseconds.
+//
+//   kernel_bench [--cases update,sort,...] [--counts 1000,100000,...]
+//                [--max-count n] [--warmup n] [--reps n] [--min-sample-ms t]
+//                [--format csv|json] [--output file]
+
+#include "bench_stats.hpp"
+#include "compact_particle.hpp"
+#include "cpu_dispatch.hpp"
+#include "particle.hpp"
+#include "particle_kernels.hpp"
+#include "particle_math.hpp"
+#include "particle_system.hpp"
+
+#include <glm/gtc/noise.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Options {
+  std::vector<std::string> cases;
+  std::vector<std::size_t> counts = {1000, 10000, 100000, 1000000, 10000000};
+  std::size_t maxCount = 0;
+  int warmup = 2;
+  int reps = 10;
+  double minSampleSeconds = 0.002;
+  std::string format = "csv";
+  std::string outputPath;
+};
+
+struct CaseResult {
+  std::string name;
+  std::string variant;
+  std::size_t count;
+  std::size_t iterations; // per sample
+  SampleStats stats;      // nanoseconds per iteration
+};
+
+// One benchmark: prepare() runs untimed before every sample and restores the
+// input, run() is one timed iteration over count items.
+struct Benchmark {
+  std::function<void()> prepare;
+  std::function<void()> run;
+  // Repeat run() within a sample until it takes minSampleSeconds. Off for
+  // cases whose state drifts from one iteration to the next.
+  bool batch = true;
+};
+
+// Keeps results alive so the measured loops are not optimized away.
+volatile float sink;
+
+const float deltaTime = 1.0f / 60.0f;
+const glm::vec3 cameraPosition(0.0f, 1.0f, 20.0f);
+
+SampleStats measure(const Options &options, Benchmark &benchmark,
+                    std::size_t &iterations) {
+  using Clock = std::chrono::steady_clock;
+  auto seconds = [](Clock::duration duration) {
+    return std::chrono::duration<double>(duration).count();
+  };
+
+  // Warmup doubles as calibration of the iterations per sample.
+  double slowest = 0.0;
+  for (int i = 0; i < std::max(1, options.warmup); ++i) {
+    benchmark.prepare();
+    Clock::time_point start = Clock::now();
+    benchmark.run();
+    slowest = std::max(slowest, seconds(Clock::now() - start));
+  }
+  iterations = 1;
+  if (benchmark.batch && slowest > 0.0 && slowest < options.minSampleSeconds)
+    iterations = static_cast<std::size_t>(options.minSampleSeconds / slowest);
+
+  std::vector<double> samples;
+  samples.reserve(options.reps);
+  for (int rep = 0; rep < options.reps; ++rep) {
+    benchmark.prepare();
+    Clock::time_point start = Clock::now();
+    for (std::size_t i = 0; i < iterations; ++i)
+      benchmark.run();
+    samples.push_back(seconds(Clock::now() - start) * 1e9 / iterations);
+  }
+  return summarize(samples);
+}
+
+// Live particles spread around the emitter, as after a few seconds of
+// simulation. Lifetimes are long enough that none dies while measured.
+std::vector<Particle> makeParticles(std::size_t count) {
+  std::mt19937 engine(1);
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  std::vector<Particle> particles(count);
+  for (Particle &particle : particles) {
+    glm::vec3 position(dist(engine) * 2.0f, 2.0f + dist(engine) * 2.0f,
+                       dist(engine) * 2.0f);
+    glm::vec3 velocity(dist(engine), 5.0f + dist(engine), dist(engine));
+    particle.activate(position, velocity, -1.5f * -9.81f, 1e6f,
+                      dist(engine) * 180.0f, 2.0f, 8, 1.0f, 0.5f);
+  }
+  return particles;
+}
+
+std::vector<CompactParticle> makeCompactParticles(std::size_t count) {
+  std::mt19937 engine(1);
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  std::vector<CompactParticle> particles(count);
+  for (CompactParticle &particle : particles) {
+    glm::vec3 position(dist(engine) * 2.0f, 2.0f + dist(engine) * 2.0f,
+                       dist(engine) * 2.0f);
+    glm::vec3 velocity(dist(engine), 5.0f + dist(engine), dist(engine));
+    // Longest lifetime the 16-bit millisecond field holds.
+    particle.activate(position, velocity, 65.0f, dist(engine) * 180.0f, 2.0f,
+                      2.0f);
+  }
+  return particles;
+}
+
+CompactParticleParams compactParams() {
+  CompactParticleParams params;
+  params.gravityEffect = -1.5f * -9.81f;
+  params.turbulenceScale = 1.0f;
+  params.turbulenceStrength = 0.5f;
+  params.averageScale = 2.0f;
+  params.textureRows = 8;
+  return params;
+}
+
+// A system whose first count slots hold live particles.
+std::unique_ptr<ParticleSystem> makeFilledSystem(std::size_t count) {
+  auto system = std::make_unique<ParticleSystem>(
+      static_cast<float>(count), 5.0f, -1.5f, 1e6f, 2.0f);
+  system->emitParticles(system->getEmitterPosition(), 1.0f);
+  return system;
+}
+
+bool wanted(const Options &options, const char *name) {
+  if (options.cases.empty())
+    return true;
+  for (const std::string &selected : options.cases)
+    if (selected == name)
+      return true;
+  return false;
+}
+
+void runCount(const Options &options, std::size_t count,
+              std::vector<CaseResult> &results) {
+  auto record = [&](const char *name, const std::string &variant,
+                    Benchmark benchmark) {
+    CaseResult result{name, variant, count, 0, {}};
+    result.stats = measure(options, benchmark, result.iterations);
+    std::cerr << name << "/" << variant << "/" << count << ": "
+              << result.stats.p50 / count << " ns per particle" << std::endl;
+    results.push_back(result);
+  };
+
+  cpu::Tier best = cpu::detectTier();
+  std::vector<cpu::Tier> tiers;
+  for (int tier = 0; tier <= static_cast<int>(best); ++tier)
+    tiers.push_back(static_cast<cpu::Tier>(tier));
+
+  if (wanted(options, "update")) {
+    std::vector<Particle> initial = makeParticles(count);
+    std::vector<Particle> particles;
+    std::uint32_t random = 1;
+    for (cpu::Tier tier : tiers) {
+      const ParticleKernels &kernels = particleKernels(tier);
+      record("update", cpu::tierName(tier),
+             {[&] {
+                particles = initial;
+                random = 1;
+              },
+              [&] {
+                kernels.update(particles.data(), count, deltaTime, random);
+              }});
+    }
+  }
+
+  if (wanted(options, "update_compact")) {
+    std::vector<CompactParticle> initial = makeCompactParticles(count);
+    std::vector<CompactParticle> particles;
+    CompactParticleParams params = compactParams();
+    std::uint32_t random = 1;
+    for (cpu::Tier tier : tiers) {
+      const ParticleKernels &kernels = particleKernels(tier);
+      record("update_compact", cpu::tierName(tier),
+             {[&] {
+                particles = initial;
+                random = 1;
+              },
+              [&] {
+                kernels.updateCompact(particles.data(), count, deltaTime,
+                                      params, random);
+              }});
+    }
+  }
+
+  if (wanted(options, "depth_keys")) {
+    std::vector<Particle> particles = makeParticles(count);
+    std::vector<float> keys(count);
+    for (cpu::Tier tier : tiers) {
+      const ParticleKernels &kernels = particleKernels(tier);
+      record("depth_keys", cpu::tierName(tier),
+             {[] {},
+              [&] {
+                kernels.depthKeys(particles.data(), count, cameraPosition.x,
+                                  cameraPosition.y, cameraPosition.z,
+                                  keys.data());
+              }});
+    }
+  }
+
+  if (wanted(options, "perlin")) {
+    // The three lookups the update kernel makes per particle: port_<tier> is
+    // the scalar port update() runs, glm the reference it was ported from,
+    // which is off the hot path.
+    std::vector<Particle> particles = makeParticles(count);
+    for (cpu::Tier tier : tiers) {
+      const ParticleKernels &kernels = particleKernels(tier);
+      record("perlin", std::string("port_") + cpu::tierName(tier),
+             {[] {},
+              [&] { sink = kernels.perlinSum(particles.data(), count); }});
+    }
+    record("perlin", "glm",
+           {[] {},
+            [&] {
+              float sum = 0.0f;
+              for (const Particle &particle : particles) {
+                glm::vec3 p = particle.getPosition();
+                sum += glm::perlin(p) + glm::perlin(p + 100.0f) +
+                       glm::perlin(p + 200.0f);
+              }
+              sink = sum;
+            }});
+  }
+
+  if (wanted(options, "cone")) {
+    std::mt19937 engine(1);
+    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+    glm::vec3 direction(0.0f, 1.0f, 0.0f);
+    float deviation = glm::radians(15.0f);
+    record("cone", "mt19937",
+           {[] {},
+            [&] {
+              glm::vec3 sum(0.0f);
+              for (std::size_t i = 0; i < count; ++i) {
+                float u0 = dist(engine);
+                float u1 = dist(engine);
+                sum += unitVectorWithinCone(direction, deviation, u0, u1);
+              }
+              sink = sum.x + sum.y + sum.z;
+            }});
+  }
+
+  if (wanted(options, "sort")) {
+    std::vector<Particle> particles = makeParticles(count);
+    std::vector<float> keys(count);
+    particleKernels().depthKeys(particles.data(), count, cameraPosition.x,
+                                cameraPosition.y, cameraPosition.z,
+                                keys.data());
+    std::vector<std::uint32_t> order(count);
+    record("sort", "random",
+           {[] {}, [&] { depthSortOrder(keys.data(), order.data(), count); }});
+
+    // Steady state: the particles were gathered back to front last frame and
+    // have barely moved since.
+    std::vector<float> coherent(count);
+    depthSortOrder(keys.data(), order.data(), count);
+    std::mt19937 engine(2);
+    std::uniform_real_distribution<float> jitter(0.99f, 1.01f);
+    for (std::size_t i = 0; i < count; ++i)
+      coherent[i] = keys[order[i]] * jitter(engine);
+    record("sort", "coherent",
+           {[] {},
+            [&] { depthSortOrder(coherent.data(), order.data(), count); }});
+  }
+
+  if (wanted(options, "emit")) {
+    // One batch of 64 spawns into count live slots: the free slot search
+    // walks all of them, then the system grows. Rebuilt for every sample.
+    const int batchSize = 64;
+    std::unique_ptr<ParticleSystem> system;
+    Benchmark benchmark{
+        [&] {
+          system.reset();
+          system = makeFilledSystem(count);
+        },
+        [&] {
+          system->emitParticles(system->getEmitterPosition(),
+                                (batchSize + 0.5f) / count);
+        },
+        false};
+    record("emit", "batch64", benchmark);
+  }
+
+  if (wanted(options, "submit")) {
+    // The CPU side of drawing: one record per live particle, written into
+    // what would be the mapped stream buffer.
+    std::unique_ptr<ParticleSystem> system = makeFilledSystem(count);
+    std::vector<ParticleInstance> instances(system->getSlotCount());
+    std::vector<PackedParticleInstance> packed(system->getSlotCount());
+    record("submit", "attributes",
+           {[] {}, [&] { system->writeInstances(instances.data()); }});
+    record("submit", "packed",
+           {[] {}, [&] { system->writePackedInstances(packed.data()); }});
+  }
+}
+
+void writeCsv(std::FILE *out, const std::vector<CaseResult> &results) {
+  std::fprintf(out, "case,variant,count,iterations,samples,mean_ns,stddev_ns,"
+                    "min_ns,p50_ns,p95_ns,max_ns,ns_per_particle,"
+                    "particles_per_second\n");
+  for (const CaseResult &result : results) {
+    const SampleStats &stats = result.stats;
+    std::fprintf(out,
+                 "%s,%s,%zu,%zu,%zu,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.4f,%.0f\n",
+                 result.name.c_str(), result.variant.c_str(), result.count,
+                 result.iterations, stats.count, stats.mean, stats.stddev,
+                 stats.min, stats.p50, stats.p95, stats.max,
+                 stats.p50 / result.count, result.count * 1e9 / stats.p50);
+  }
+}
+
+void writeJson(std::FILE *out, const Options &options,
+               const std::vector<CaseResult> &results) {
+  std::fprintf(out, "{\n  \"cpu_tier\": \"%s\",\n",
+               cpu::tierName(cpu::detectTier()));
+  std::fprintf(out, "  \"warmup\": %d,\n  \"reps\": %d,\n", options.warmup,
+               options.reps);
+  std::fprintf(out, "  \"min_sample_ms\": %g,\n",
+               options.minSampleSeconds * 1000.0);
+  std::fprintf(out, "  \"results\": [\n");
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    const CaseResult &result = results[i];
+    const SampleStats &stats = result.stats;
+    std::fprintf(out,
+                 "    {\"case\": \"%s\", \"variant\": \"%s\", \"count\": %zu, "
+                 "\"iterations\": %zu, \"samples\": %zu, \"mean_ns\": %.1f, "
+                 "\"stddev_ns\": %.1f, \"min_ns\": %.1f, \"p50_ns\": %.1f, "
+                 "\"p95_ns\": %.1f, \"max_ns\": %.1f, "
+                 "\"ns_per_particle\": %.4f}%s\n",
+                 result.name.c_str(), result.variant.c_str(), result.count,
+                 result.iterations, stats.count, stats.mean, stats.stddev,
+                 stats.min, stats.p50, stats.p95, stats.max,
+                 stats.p50 / result.count,
+                 i + 1 < results.size() ? "," : "");
+  }
+  std::fprintf(out, "  ]\n}\n");
+}
+
+std::vector<std::string> splitList(const std::string &text) {
+  std::vector<std::string> items;
+  std::stringstream stream(text);
+  std::string item;
+  while (std::getline(stream, item, ','))
+    if (!item.empty())
+      items.push_back(item);
+  return items;
+}
+
+void printUsage() {
+  std::cout
+      << "usage: kernel_bench [--cases list] [--counts list] [--max-count n]\n"
+         "                    [--warmup n] [--reps n] [--min-sample-ms t]\n"
+         "                    [--format csv|json] [--output file]\n"
+         "cases: update, update_compact, depth_keys, perlin, cone, sort, "
+         "emit, submit\n"
+         "counts default to 1000,10000,100000,1000000,10000000\n";
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--help") || !strcmp(argv[i], "-h")) {
+      printUsage();
+      return 0;
+    }
+    if (strncmp(argv[i], "--", 2) || i + 1 >= argc) {
+      std::cerr << "Expected --option value, got " << argv[i] << std::endl;
+      printUsage();
+      return 2;
+    }
+    std::string key = argv[i] + 2;
+    std::string value = argv[++i];
+    if (key == "cases") {
+      options.cases = splitList(value);
+    } else if (key == "counts") {
+      options.counts.clear();
+      for (const std::string &item : splitList(value))
+        options.counts.push_back(std::strtoull(item.c_str(), nullptr, 10));
+    } else if (key == "max-count") {
+      options.maxCount = std::strtoull(value.c_str(), nullptr, 10);
+    } else if (key == "warmup") {
+      options.warmup = std::atoi(value.c_str());
+    } else if (key == "reps") {
+      options.reps = std::max(1, std::atoi(value.c_str()));
+    } else if (key == "min-sample-ms") {
+      options.minSampleSeconds = std::atof(value.c_str()) / 1000.0;
+    } else if (key == "format" && (value == "csv" || value == "json")) {
+      options.format = value;
+    } else if (key == "output") {
+      options.outputPath = value;
+    } else {
+      std::cerr << "Unknown option --" << key << " " << value << std::endl;
+      printUsage();
+      return 2;
+    }
+  }
+
+  std::vector<CaseResult> results;
+  for (std::size_t count : options.counts) {
+    if (count == 0 || (options.maxCount && count > options.maxCount))
+      continue;
+    runCount(options, count, results);
+  }
+
+  std::FILE *out = stdout;
+  if (!options.outputPath.empty() &&
+      !(out = std::fopen(options.outputPath.c_str(), "w"))) {
+    std::cerr << "Cannot write " << options.outputPath << std::endl;
+    return 1;
+  }
+  if (options.format == "json")
+    writeJson(out, options, results);
+  else
+    writeCsv(out, results);
+  if (out != stdout)
+    std::fclose(out);
+  return 0;
+}
@@ -0,0 +1,430 @@
+// Headless simulation benchmark: runs ParticleSystem::update and writeFrame
+// for a scenario with a fixed time step and reports per-phase frame times,
+// percentiles and particle throughput as CSV or JSON. Needs no window or GL
+// context.
+//
+//   particle_bench [--scenario file] [--<key> value]... [--format csv|json]
+//                  [--output file] [--counters]
+//
+// --counters adds hardware counters per phase through perf_event_open (Linux)
+// and metrics derived from them. Reading the counters costs a few
+// microseconds per phase, which shows in the timings of small scenes.
+//
+//   particle_bench --gate baseline [--gate-runs n] [--gate-threshold pct]
+//                  [--gate-scenarios dir] [--update-baseline]
+//
+// runs the gate scenario set and compares it with the baseline file, see
+// bench_gate.hpp. Exits 1 on a regression.
+//
+// A scenario is a stress scene (stress_scene.hpp) plus how long to run it, so
+// --preset torches --emitters 2500 --seed 3 is one point of a scaling curve.
+
+#include "bench_gate.hpp"
+#include "bench_scenario.hpp"
+#include "bench_stats.hpp"
+#include "cpu_dispatch.hpp"
+#include "frame_arena.hpp"
+#include "particle_frame.hpp"
+#include "particle_system.hpp"
+#include "perf_counters.hpp"
+#include "stress_scene.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Per-frame phases, summed over all emitters.
+enum Phase { Simulate, Sort, Emit, Update, Write, Total, PhaseCount };
+const char *phaseNames[PhaseCount] = {"simulate", "sort",  "emit",
+                                      "update",   "write", "total"};
+
+// Line size used to turn last level misses into memory traffic.
+const double cacheLineBytes = 64.0;
+
+struct BenchResult {
+  std::vector<double> phaseSamples[PhaseCount]; // milliseconds
+  std::vector<double> liveParticles;
+  // Over all measured frames, when counting.
+  PerfCounters::Sample counterTotals[PhaseCount];
+  double liveParticleTotal = 0.0;
+};
+
+// Collects the counters of the phases inside ParticleSystem::update(), which
+// share their order with the first entries of Phase.
+class PhaseCounters : public ParticleSystem::StepObserver {
+public:
+  explicit PhaseCounters(const PerfCounters &counters) : counters(counters) {}
+
+  void beginPhase(ParticleSystem::StepPhase) override {
+    start = counters.read();
+  }
+  void endPhase(ParticleSystem::StepPhase phase) override {
+    frame[static_cast<int>(phase)] += counters.read() - start;
+  }
+
+  // This frame so far, cleared by the frame loop.
+  PerfCounters::Sample frame[PhaseCount];
+
+private:
+  const PerfCounters &counters;
+  PerfCounters::Sample start;
+};
+
+BenchResult run(const BenchScenario &scenario, const PerfCounters *counters) {
+  using Clock = std::chrono::steady_clock;
+  auto milliseconds = [](Clock::duration duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+  };
+
+  std::unique_ptr<PhaseCounters> phaseCounters;
+  if (counters)
+    phaseCounters = std::make_unique<PhaseCounters>(*counters);
+  auto readCounters = [&] {
+    return counters ? counters->read() : PerfCounters::Sample();
+  };
+
+  StressScene scene = generateStressScene(scenario.scene);
+  std::vector<std::unique_ptr<ParticleSystem>> emitters =
+      scene.createEmitters();
+  for (auto &emitter : emitters)
+    emitter->setStepObserver(phaseCounters.get());
+  ParticleFrame frame;
+
+  // Rounded, as 2 / (1 / 60.0f) comes out just under 120.
+  int warmupSteps =
+      static_cast<int>(std::lround(scenario.warmup / scenario.timeStep));
+  int measuredSteps =
+      static_cast<int>(std::lround(scenario.duration / scenario.timeStep));
+  BenchResult result;
+  for (auto &samples : result.phaseSamples)
+    samples.reserve(measuredSteps);
+  result.liveParticles.reserve(measuredSteps);
+
+  for (int step = 0; step < warmupSteps + measuredSteps; ++step) {
+    float time = step * scenario.timeStep;
+    glm::vec3 camera = scene.cameraPosition(time);
+
+    double phases[PhaseCount] = {};
+    double live = 0.0;
+    PerfCounters::Sample frameCounters[PhaseCount];
+    if (phaseCounters)
+      std::fill(std::begin(phaseCounters->frame),
+                std::end(phaseCounters->frame), PerfCounters::Sample());
+    PerfCounters::Sample frameStartCounters = readCounters();
+    Clock::time_point frameStart = Clock::now();
+    for (auto &emitter : emitters) {
+      PerfCounters::Sample startCounters = readCounters();
+      Clock::time_point start = Clock::now();
+      emitter->update(scenario.timeStep, camera);
+      Clock::time_point updated = Clock::now();
+      PerfCounters::Sample updatedCounters = readCounters();
+      emitter->writeFrame(frame);
+      Clock::time_point written = Clock::now();
+      frameCounters[Update] += updatedCounters - startCounters;
+      frameCounters[Write] += readCounters() - updatedCounters;
+
+      const ParticleSystem::StepTimings &timings = emitter->getStepTimings();
+      phases[Simulate] += timings.simulate * 1000.0;
+      phases[Sort] += timings.sort * 1000.0;
+      phases[Emit] += timings.emit * 1000.0;
+      phases[Update] += milliseconds(updated - start);
+      phases[Write] += milliseconds(written - updated);
+      live += frame.instances.size();
+    }
+    phases[Total] = milliseconds(Clock::now() - frameStart);
+    frameCounters[Total] = readCounters() - frameStartCounters;
+    // update() takes its sort keys and order from this thread's arena; the
+    // app and the simulation thread reset it once per frame too.
+    FrameArena::local().reset();
+
+    if (step < warmupSteps)
+      continue;
+    for (int phase = 0; phase < PhaseCount; ++phase)
+      result.phaseSamples[phase].push_back(phases[phase]);
+    result.liveParticles.push_back(live);
+    result.liveParticleTotal += live;
+    if (phaseCounters) {
+      for (int phase = Simulate; phase <= Emit; ++phase)
+        frameCounters[phase] = phaseCounters->frame[phase];
+      for (int phase = 0; phase < PhaseCount; ++phase)
+        result.counterTotals[phase] += frameCounters[phase];
+    }
+  }
+  return result;
+}
+
+// Live particles per second of phase time.
+double throughput(const SampleStats &live, const SampleStats &phase) {
+  return phase.mean > 0.0 ? live.mean / (phase.mean / 1000.0) : 0.0;
+}
+
+// Counter metrics of one phase over the measured frames; negative where the
+// event was not counted.
+struct CounterMetrics {
+  double perFrame[PerfCounters::EventCount];
+  double ipc = -1.0;
+  double l1dMissesPerParticle = -1.0;
+  double llcMissesPerParticle = -1.0;
+  double branchMissesPerParticle = -1.0;
+  double bytesPerParticle = -1.0;
+};
+
+CounterMetrics counterMetrics(const PerfCounters &counters,
+                              const BenchResult &result, int phase) {
+  const PerfCounters::Sample &total = result.counterTotals[phase];
+  CounterMetrics metrics;
+  double frames = static_cast<double>(result.liveParticles.size());
+  double particles = result.liveParticleTotal;
+  for (int event = 0; event < PerfCounters::EventCount; ++event) {
+    bool counted = counters.isAvailable(static_cast<PerfCounters::Event>(event));
+    metrics.perFrame[event] =
+        counted && frames > 0.0 ? total.values[event] / frames : -1.0;
+  }
+  auto perParticle = [&](PerfCounters::Event event) {
+    return counters.isAvailable(event) && particles > 0.0
+               ? total.values[event] / particles
+               : -1.0;
+  };
+  if (counters.isAvailable(PerfCounters::Cycles) &&
+      counters.isAvailable(PerfCounters::Instructions) &&
+      total.values[PerfCounters::Cycles] > 0)
+    metrics.ipc = double(total.values[PerfCounters::Instructions]) /
+                  total.values[PerfCounters::Cycles];
+  metrics.l1dMissesPerParticle = perParticle(PerfCounters::L1dMisses);
+  metrics.llcMissesPerParticle = perParticle(PerfCounters::LlcMisses);
+  metrics.branchMissesPerParticle = perParticle(PerfCounters::BranchMisses);
+  if (metrics.llcMissesPerParticle >= 0.0)
+    metrics.bytesPerParticle = metrics.llcMissesPerParticle * cacheLineBytes;
+  return metrics;
+}
+
+// Empty field in CSV, null in JSON, for metrics that were not counted.
+void printMetric(std::FILE *out, double value, const char *missing) {
+  if (value < 0.0)
+    std::fputs(missing, out);
+  else
+    std::fprintf(out, "%.4g", value);
+}
+
+void writeCsv(std::FILE *out, const BenchScenario &scenario,
+              const BenchResult &result, const PerfCounters *counters) {
+  SampleStats live = summarize(result.liveParticles);
+  std::fprintf(out, "scenario,phase,frames,live_particles,mean_ms,p50_ms,"
+                    "p95_ms,p99_ms,max_ms,particles_per_second");
+  if (counters) {
+    for (int event = 0; event < PerfCounters::EventCount; ++event)
+      std::fprintf(out, ",%s_per_frame",
+                   PerfCounters::eventName(static_cast<PerfCounters::Event>(event)));
+    std::fprintf(out, ",ipc,l1d_misses_per_particle,llc_misses_per_particle,"
+                      "branch_misses_per_particle,bytes_per_particle");
+  }
+  std::fprintf(out, "\n");
+  for (int phase = 0; phase < PhaseCount; ++phase) {
+    SampleStats stats = summarize(result.phaseSamples[phase]);
+    std::fprintf(out, "%s,%s,%zu,%.0f,%.4f,%.4f,%.4f,%.4f,%.4f,%.0f",
+                 scenario.name.c_str(), phaseNames[phase], stats.count,
+                 live.mean, stats.mean, stats.p50, stats.p95, stats.p99,
+                 stats.max, throughput(live, stats));
+    if (counters) {
+      CounterMetrics metrics = counterMetrics(*counters, result, phase);
+      double derived[] = {metrics.ipc, metrics.l1dMissesPerParticle,
+                          metrics.llcMissesPerParticle,
+                          metrics.branchMissesPerParticle,
+                          metrics.bytesPerParticle};
+      for (double value : metrics.perFrame) {
+        std::fputc(',', out);
+        printMetric(out, value, "");
+      }
+      for (double value : derived) {
+        std::fputc(',', out);
+        printMetric(out, value, "");
+      }
+    }
+    std::fprintf(out, "\n");
+  }
+}
+
+void writeJson(std::FILE *out, const BenchScenario &scenario,
+               const BenchResult &result, const PerfCounters *counters) {
+  SampleStats live = summarize(result.liveParticles);
+  std::fprintf(out, "{\n  \"scenario\": {\n");
+  std::fprintf(out, "    \"name\": \"%s\",\n", scenario.name.c_str());
+  const StressSceneConfig &scene = scenario.scene;
+  std::fprintf(out, "    \"seed\": %u,\n", static_cast<unsigned>(scene.seed));
+  std::fprintf(out, "    \"layout\": \"%s\",\n",
+               stressLayoutName(scene.layout));
+  std::fprintf(out, "    \"emitters\": %d,\n", scene.emitters);
+  std::fprintf(out, "    \"spacing\": %g,\n", scene.spacing);
+  std::fprintf(out, "    \"pps\": %g,\n", scene.emitter.pps);
+  std::fprintf(out, "    \"pps_spread\": %g,\n", scene.ppsSpread);
+  std::fprintf(out, "    \"lifetime\": %g,\n",
+               scene.emitter.averageLifeLength);
+  std::fprintf(out, "    \"life_spread\": %g,\n", scene.lifeSpread);
+  std::fprintf(out, "    \"turbulence\": %g,\n",
+               scene.emitter.turbulenceStrength);
+  std::fprintf(out, "    \"turbulence_scale\": %g,\n",
+               scene.emitter.turbulenceScale);
+  std::fprintf(out, "    \"storage\": \"%s\",\n",
+               scene.emitter.storage == ParticleStorage::Compact ? "compact"
+                                                                 : "full");
+  std::fprintf(out, "    \"camera\": \"%s\",\n",
+               cameraPathName(scene.camera));
+  std::fprintf(out, "    \"warmup\": %g,\n", scenario.warmup);
+  std::fprintf(out, "    \"duration\": %g,\n", scenario.duration);
+  std::fprintf(out, "    \"dt\": %g\n  },\n", scenario.timeStep);
+  std::fprintf(out, "  \"cpu_tier\": \"%s\",\n",
+               cpu::tierName(cpu::activeTier()));
+  std::fprintf(out, "  \"frames\": %zu,\n", live.count);
+  std::fprintf(out,
+               "  \"live_particles\": {\"mean\": %.0f, \"max\": %.0f},\n",
+               live.mean, live.max);
+  std::fprintf(out, "  \"phases\": {\n");
+  for (int phase = 0; phase < PhaseCount; ++phase) {
+    SampleStats stats = summarize(result.phaseSamples[phase]);
+    std::fprintf(out,
+                 "    \"%s\": {\"mean_ms\": %.4f, \"stddev_ms\": %.4f, "
+                 "\"p50_ms\": %.4f, \"p95_ms\": %.4f, \"p99_ms\": %.4f, "
+                 "\"max_ms\": %.4f, \"particles_per_second\": %.0f",
+                 phaseNames[phase], stats.mean, stats.stddev, stats.p50,
+                 stats.p95, stats.p99, stats.max, throughput(live, stats));
+    if (counters) {
+      CounterMetrics metrics = counterMetrics(*counters, result, phase);
+      std::fprintf(out, ", \"counters_per_frame\": {");
+      for (int event = 0; event < PerfCounters::EventCount; ++event) {
+        std::fprintf(out, "%s\"%s\": ", event ? ", " : "",
+                     PerfCounters::eventName(static_cast<PerfCounters::Event>(event)));
+        printMetric(out, metrics.perFrame[event], "null");
+      }
+      std::fprintf(out, "}, \"ipc\": ");
+      printMetric(out, metrics.ipc, "null");
+      std::fprintf(out, ", \"l1d_misses_per_particle\": ");
+      printMetric(out, metrics.l1dMissesPerParticle, "null");
+      std::fprintf(out, ", \"llc_misses_per_particle\": ");
+      printMetric(out, metrics.llcMissesPerParticle, "null");
+      std::fprintf(out, ", \"branch_misses_per_particle\": ");
+      printMetric(out, metrics.branchMissesPerParticle, "null");
+      std::fprintf(out, ", \"bytes_per_particle\": ");
+      printMetric(out, metrics.bytesPerParticle, "null");
+    }
+    std::fprintf(out, "}%s\n", phase + 1 < PhaseCount ? "," : "");
+  }
+  std::fprintf(out, "  }\n}\n");
+}
+
+void printUsage() {
+  std::cout << "usage: particle_bench [--scenario file] [--<key> value]...\n"
+               "                      [--format csv|json] [--output file]\n"
+               "                      [--counters]\n"
+               "       particle_bench --gate baseline [--gate-runs n]\n"
+               "                      [--gate-threshold pct] "
+               "[--gate-scenarios dir]\n"
+               "                      [--update-baseline]\n"
+               "Scenario keys (file: key = value, flags: --key value):\n"
+            << scenarioKeysHelp() << stressSceneKeysHelp()
+            << "Presets:\n"
+            << stressPresetsHelp();
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  BenchScenario scenario;
+  std::string format = "csv";
+  std::string outputPath;
+  bool countersRequested = false;
+  GateOptions gate;
+  gate.scenarioDirectory = BENCH_GATE_SCENARIOS;
+
+  // Applied in order, so flags after --scenario override the file.
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--help") || !strcmp(argv[i], "-h")) {
+      printUsage();
+      return 0;
+    }
+    if (!strcmp(argv[i], "--counters")) {
+      countersRequested = true;
+      continue;
+    }
+    if (!strcmp(argv[i], "--update-baseline")) {
+      gate.updateBaseline = true;
+      continue;
+    }
+    if (strncmp(argv[i], "--", 2) || i + 1 >= argc) {
+      std::cerr << "Expected --key value, got " << argv[i] << std::endl;
+      printUsage();
+      return 2;
+    }
+    std::string key = argv[i] + 2;
+    std::string value = argv[++i];
+    bool valid = true;
+    if (key == "scenario")
+      valid = loadScenario(value, scenario);
+    else if (key == "format")
+      valid = (format = value) == "csv" || format == "json";
+    else if (key == "output")
+      outputPath = value;
+    else if (key == "gate")
+      gate.baselinePath = value;
+    else if (key == "gate-runs")
+      valid = (gate.runs = std::atoi(value.c_str())) > 0;
+    else if (key == "gate-threshold")
+      valid = (gate.threshold = std::atof(value.c_str()) / 100.0) > 0.0;
+    else if (key == "gate-scenarios")
+      gate.scenarioDirectory = value;
+    else
+      valid = setScenarioValue(scenario, key, value);
+    if (!valid)
+      return 2;
+  }
+
+  if (!gate.baselinePath.empty()) {
+    return runGate(gate, [](const BenchScenario &gateScenario) {
+      BenchResult result = run(gateScenario, nullptr);
+      std::vector<std::pair<std::string, double>> medians;
+      for (int phase = 0; phase < PhaseCount; ++phase)
+        medians.emplace_back(phaseNames[phase],
+                             summarize(result.phaseSamples[phase]).p50);
+      return medians;
+    });
+  }
+  if (gate.updateBaseline) {
+    std::cerr << "--update-baseline needs --gate <baseline>" << std::endl;
+    return 2;
+  }
+
+  // Unavailable counters leave the columns empty rather than failing the
+  // run, so nightly jobs on machines without a PMU keep working.
+  PerfCounters perfCounters;
+  const PerfCounters *counters = nullptr;
+  if (countersRequested) {
+    counters = &perfCounters;
+    if (!perfCounters.open())
+      std::cerr << "Hardware counters unavailable: " << perfCounters.getError()
+                << std::endl;
+  }
+
+  BenchResult result = run(scenario, counters);
+
+  std::FILE *out = stdout;
+  if (!outputPath.empty() && !(out = std::fopen(outputPath.c_str(), "w"))) {
+    std::cerr << "Cannot write " << outputPath << std::endl;
+    return 1;
+  }
+  if (format == "json")
+    writeJson(out, scenario, result, counters);
+  else
+    writeCsv(out, scenario, result, counters);
+  if (out != stdout)
+    std::fclose(out);
+  return 0;
+}
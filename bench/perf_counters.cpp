@@ -0,0 +1,129 @@
+#include "perf_counters.hpp"
+
+#if defined(__linux__)
+#include <cerrno>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char *eventNames[PerfCounters::EventCount] = {
+    "cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses"};
+
+} // namespace
+
+PerfCounters::Sample &PerfCounters::Sample::operator+=(const Sample &other) {
+  for (int i = 0; i < EventCount; ++i)
+    values[i] += other.values[i];
+  return *this;
+}
+
+PerfCounters::Sample
+PerfCounters::Sample::operator-(const Sample &other) const {
+  Sample difference;
+  for (int i = 0; i < EventCount; ++i)
+    difference.values[i] =
+        values[i] > other.values[i] ? values[i] - other.values[i] : 0;
+  return difference;
+}
+
+const char *PerfCounters::eventName(Event event) { return eventNames[event]; }
+
+bool PerfCounters::isAvailable(Event event) const {
+  return descriptors[event] >= 0;
+}
+
+const std::string &PerfCounters::getError() const { return error; }
+
+#if defined(__linux__)
+
+namespace {
+
+struct EventConfig {
+  std::uint32_t type;
+  std::uint64_t config;
+};
+
+const EventConfig eventConfigs[PerfCounters::EventCount] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                             (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                             (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    // The generic cache miss event counts last level misses on x86 and most
+    // ARM cores.
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+};
+
+} // namespace
+
+PerfCounters::~PerfCounters() {
+  for (int &descriptor : descriptors) {
+    if (descriptor >= 0)
+      close(descriptor);
+    descriptor = -1;
+  }
+}
+
+bool PerfCounters::open() {
+  bool any = false;
+  for (int i = 0; i < EventCount; ++i) {
+    if (descriptors[i] >= 0) {
+      any = true;
+      continue;
+    }
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = eventConfigs[i].type;
+    attr.config = eventConfigs[i].config;
+    attr.read_format =
+        PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    // User space only, which perf_event_paranoid 2 still allows.
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    long descriptor = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    if (descriptor < 0) {
+      if (error.empty())
+        error = std::string(eventNames[i]) + ": " + std::strerror(errno);
+      continue;
+    }
+    descriptors[i] = static_cast<int>(descriptor);
+    any = true;
+  }
+  return any;
+}
+
+PerfCounters::Sample PerfCounters::read() const {
+  Sample sample;
+  for (int i = 0; i < EventCount; ++i) {
+    if (descriptors[i] < 0)
+      continue;
+    std::uint64_t data[3]; // value, time enabled, time running
+    if (::read(descriptors[i], data, sizeof(data)) != sizeof(data) ||
+        data[2] == 0)
+      continue;
+    double scale = data[1] > data[2] ? double(data[1]) / data[2] : 1.0;
+    sample.values[i] = static_cast<std::uint64_t>(data[0] * scale);
+  }
+  return sample;
+}
+
+#else
+
+PerfCounters::~PerfCounters() = default;
+
+bool PerfCounters::open() {
+  error = "perf_event_open is Linux only";
+  return false;
+}
+
+PerfCounters::Sample PerfCounters::read() const { return Sample(); }
+
+#endif
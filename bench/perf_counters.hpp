@@ -0,0 +1,51 @@
+#ifndef PERF_COUNTERS_HPP
+#define PERF_COUNTERS_HPP
+
+#include <cstdint>
+#include <string>
+
+// Hardware event counters of the calling thread through Linux
+// perf_event_open, user space only. Every event is opened on its own, so
+// whatever the kernel, CPU or hypervisor supports is counted and the rest
+// reads as unavailable. On other platforms nothing opens.
+class PerfCounters {
+public:
+  enum Event {
+    Cycles,
+    Instructions,
+    L1dMisses,
+    LlcMisses,
+    BranchMisses,
+    EventCount
+  };
+
+  // Running totals since open(), scaled up when the kernel had to multiplex
+  // the events.
+  struct Sample {
+    std::uint64_t values[EventCount] = {};
+
+    Sample &operator+=(const Sample &other);
+    Sample operator-(const Sample &other) const;
+  };
+
+  PerfCounters() = default;
+  ~PerfCounters();
+  PerfCounters(const PerfCounters &) = delete;
+  PerfCounters &operator=(const PerfCounters &) = delete;
+
+  // True if at least one event could be opened; otherwise getError() says
+  // why.
+  bool open();
+  bool isAvailable(Event event) const;
+  const std::string &getError() const;
+
+  Sample read() const;
+
+  static const char *eventName(Event event);
+
+private:
+  int descriptors[EventCount] = {-1, -1, -1, -1, -1};
+  std::string error;
+};
+
+#endif // PERF_COUNTERS_HPP
@@ -0,0 +1,17 @@
+#version 460 core
+
+uniform sampler2D sceneDepth;
+uniform int divisor;
+
+// Farthest depth of the divisor x divisor block, so geometry edges never
+// hide particles that are in front at full resolution; the upsample picks
+// the right samples back.
+void main() {
+    ivec2 base = ivec2(gl_FragCoord.xy) * divisor;
+    ivec2 last = textureSize(sceneDepth, 0) - 1;
+    float depth = 0.0;
+    for (int y = 0; y < divisor; ++y)
+        for (int x = 0; x < divisor; ++x)
+            depth = max(depth, texelFetch(sceneDepth, min(base + ivec2(x, y), last), 0).r);
+    gl_FragDepth = depth;
+}
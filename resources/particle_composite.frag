@@ -0,0 +1,50 @@
+#version 460 core
+
+layout(std140, binding = 0) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec4 cameraPosition;
+    vec4 cameraRight;
+    vec4 cameraUp;
+    vec4 time;
+};
+
+uniform sampler2D sceneDepth;
+uniform sampler2D particleDepth;
+uniform sampler2D particleColor;
+// Relative depth difference above which the bilinear footprint is treated as
+// crossing an edge.
+uniform float depthThreshold;
+
+out vec4 FragColor;
+
+float linearDepth(float depth) {
+    return projection[3][2] / (depth * 2.0 - 1.0 + projection[2][2]);
+}
+
+// Nearest-depth upsample: bilinear where the four low resolution samples
+// agree with the full resolution depth, otherwise the sample closest in depth.
+void main() {
+    vec2 sceneSize = vec2(textureSize(sceneDepth, 0));
+    ivec2 particleSize = textureSize(particleColor, 0);
+    vec2 uv = gl_FragCoord.xy / sceneSize;
+
+    float depth = linearDepth(texelFetch(sceneDepth, ivec2(gl_FragCoord.xy), 0).r);
+
+    ivec2 base = ivec2(floor(uv * vec2(particleSize) - 0.5));
+    float largestError = 0.0;
+    float nearestError = 1e30;
+    vec4 nearestColor = vec4(0.0);
+    for (int i = 0; i < 4; ++i) {
+        ivec2 texel = clamp(base + ivec2(i & 1, i >> 1), ivec2(0), particleSize - 1);
+        float error = abs(linearDepth(texelFetch(particleDepth, texel, 0).r) - depth);
+        if (error < nearestError) {
+            nearestError = error;
+            nearestColor = texelFetch(particleColor, texel, 0);
+        }
+        largestError = max(largestError, error);
+    }
+
+    FragColor = largestError < depthThreshold * depth ? texture(particleColor, uv)
+                                                      : nearestColor;
+}
@@ -1,10 +1,10 @@
 #version 460 core
 in vec2 texCoords1;
 in vec2 texCoords2;
+flat in float blendFactor;
+flat in float lifeFactor;
 
 uniform sampler2D atlasTexture;
-uniform float blendFactor;
-uniform float lifeFactor;
 
 out vec4 FragColor;
 
@@ -1,25 +1,97 @@
 #version 460 core
+
+#ifdef VERTEX_PULLING
+// See PackedParticleInstance
+struct PackedInstance {
+    uint positionXY;
+    uint positionZScale;
+    uint rotationLife;
+    uint frameBlend;
+};
+
+layout(std430, binding = 1) readonly buffer Instances {
+    PackedInstance instances[];
+};
+
+uniform vec3 instanceOrigin;
+#else
+#ifndef TRIMMED_QUADS
 layout(location = 0) in vec3 aPos;
 layout(location = 1) in vec2 aTexCoords;
+#endif
+
+// Per-instance, see ParticleInstance
+layout(location = 2) in vec3 particlePosition;
+layout(location = 3) in vec4 particleParams; // scale, rotation, blend, life
+layout(location = 4) in uvec2 textureIndices; // current, next
+#endif
+
+#ifdef TRIMMED_QUADS
+// TRIM_VERTICES convex polygon per atlas frame in frame texture coordinates,
+// drawn as a fan, see AtlasTrim
+layout(std430, binding = 2) readonly buffer TrimPolygons {
+    vec2 trimPolygons[];
+};
+#endif
 
-uniform mat4 view;
-uniform mat4 projection;
-uniform vec3 particlePosition;
-uniform float particleScale;
-uniform float particleRotation;
+layout(std140, binding = 0) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec4 cameraPosition;
+    vec4 cameraRight;
+    vec4 cameraUp;
+    vec4 time;
+};
 
 out vec2 texCoords1;
 out vec2 texCoords2;
+flat out float blendFactor;
+flat out float lifeFactor;
 
 uniform int textureRows;
-uniform int currentTextureIndex;
-uniform int nextTextureIndex;
 
 void main()
 {
-    // Camera right and up vectors
-    vec3 cameraRight = vec3(view[0][0], view[1][0], view[2][0]);
-    vec3 cameraUp    = vec3(view[0][1], view[1][1], view[2][1]);
+#ifdef VERTEX_PULLING
+    PackedInstance record = instances[gl_InstanceID];
+
+    vec2 positionXY = unpackHalf2x16(record.positionXY);
+    vec2 positionZScale = unpackHalf2x16(record.positionZScale);
+    vec2 rotationLife = unpackUnorm2x16(record.rotationLife);
+
+    vec3 particlePosition = instanceOrigin + vec3(positionXY, positionZScale.x);
+    float particleScale = positionZScale.y;
+    float particleRotation = rotationLife.x * 6.28318530718;
+    int currentTextureIndex = int(record.frameBlend & 0xffffu);
+    int nextTextureIndex = min(currentTextureIndex + 1,
+                               textureRows * textureRows - 1);
+
+    blendFactor = float(record.frameBlend >> 16) / 65535.0;
+    lifeFactor = rotationLife.y;
+#else
+    float particleScale = particleParams.x;
+    float particleRotation = particleParams.y;
+    int currentTextureIndex = int(textureIndices.x);
+    int nextTextureIndex = int(textureIndices.y);
+
+    blendFactor = particleParams.z;
+    lifeFactor = particleParams.w;
+#endif
+
+#if defined(TRIMMED_QUADS)
+    // Fan: triangle t uses polygon vertices 0, t + 1, t + 2
+    int triangle = gl_VertexID / 3;
+    int fanCorner = gl_VertexID % 3;
+    int polygonVertex = fanCorner == 0 ? 0 : triangle + fanCorner;
+    vec2 corner = trimPolygons[currentTextureIndex * TRIM_VERTICES + polygonVertex];
+    vec3 aPos = vec3(corner - 0.5, 0.0);
+    vec2 aTexCoords = corner;
+#elif defined(VERTEX_PULLING)
+    // Triangle strip corners 0..3: (0,0) (1,0) (0,1) (1,1)
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    vec3 aPos = vec3(corner - 0.5, 0.0);
+    vec2 aTexCoords = corner;
+#endif
 
     // Rotate the quad corners
     float cosTheta = cos(particleRotation);
@@ -31,8 +103,8 @@ void main()
 
     // Scale and position the quad
     vec3 worldPos = particlePosition +
-                    cameraRight * rotatedPos.x * particleScale +
-                    cameraUp    * rotatedPos.y * particleScale;
+                    cameraRight.xyz * rotatedPos.x * particleScale +
+                    cameraUp.xyz    * rotatedPos.y * particleScale;
 
     gl_Position = projection * view * vec4(worldPos, 1.0);
 
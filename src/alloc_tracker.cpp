@@ -0,0 +1,264 @@
+#include "alloc_tracker.hpp"
+
+#if ALLOC_TRACKING
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+
+namespace allocTracker {
+
+namespace {
+
+constexpr int maxScopes = 32;
+
+struct AtomicCounters {
+  std::atomic<std::uint64_t> allocations{0};
+  std::atomic<std::uint64_t> frees{0};
+  std::atomic<std::uint64_t> bytes{0};
+
+  Counters take() {
+    Counters counters;
+    counters.allocations = allocations.exchange(0, std::memory_order_relaxed);
+    counters.frees = frees.exchange(0, std::memory_order_relaxed);
+    counters.bytes = bytes.exchange(0, std::memory_order_relaxed);
+    return counters;
+  }
+};
+
+// Everything below is static storage; the tracker itself must never call
+// operator new.
+AtomicCounters total;
+AtomicCounters scopeCounters[maxScopes];
+const char *scopeNames[maxScopes];
+std::atomic<int> scopeCount{0};
+std::mutex registerMutex;
+
+std::mutex frameMutex;
+Counters lastTotal;
+ScopeCounters lastScopes[maxScopes];
+int lastScopeCount = 0;
+
+std::atomic<bool> strict{false};
+std::atomic<bool> armed{false};
+std::atomic<int> warmupFrames{300};
+std::atomic<int> framesSinceWarmup{0};
+std::atomic<std::uint64_t> frameNumber{0};
+
+thread_local int currentScope = -1;
+
+int registerScope(const char *name) {
+  int count = scopeCount.load(std::memory_order_acquire);
+  for (int i = 0; i < count; ++i) {
+    if (scopeNames[i] == name || !strcmp(scopeNames[i], name))
+      return i;
+  }
+
+  std::lock_guard<std::mutex> lock(registerMutex);
+  count = scopeCount.load(std::memory_order_relaxed);
+  for (int i = 0; i < count; ++i) {
+    if (!strcmp(scopeNames[i], name))
+      return i;
+  }
+  if (count == maxScopes)
+    return -1;
+  scopeNames[count] = name;
+  scopeCount.store(count + 1, std::memory_order_release);
+  return count;
+}
+
+void recordAllocation(std::size_t size) {
+  total.allocations.fetch_add(1, std::memory_order_relaxed);
+  total.bytes.fetch_add(size, std::memory_order_relaxed);
+
+  int scope = currentScope;
+  if (scope < 0)
+    return;
+  scopeCounters[scope].allocations.fetch_add(1, std::memory_order_relaxed);
+  scopeCounters[scope].bytes.fetch_add(size, std::memory_order_relaxed);
+
+  if (armed.load(std::memory_order_relaxed)) {
+    std::fprintf(stderr,
+                 "Strict allocation mode: %zu byte allocation in scope '%s' "
+                 "during steady-state frame %llu\n",
+                 size, scopeNames[scope],
+                 static_cast<unsigned long long>(frameNumber.load()));
+    std::abort();
+  }
+}
+
+void recordFree() {
+  total.frees.fetch_add(1, std::memory_order_relaxed);
+  int scope = currentScope;
+  if (scope >= 0)
+    scopeCounters[scope].frees.fetch_add(1, std::memory_order_relaxed);
+}
+
+void *allocate(std::size_t size) {
+  recordAllocation(size);
+  if (size == 0)
+    size = 1;
+  while (true) {
+    if (void *pointer = std::malloc(size))
+      return pointer;
+    std::new_handler handler = std::get_new_handler();
+    if (!handler)
+      throw std::bad_alloc();
+    handler();
+  }
+}
+
+void *allocateAligned(std::size_t size, std::size_t alignment) {
+  recordAllocation(size);
+  if (alignment < sizeof(void *))
+    alignment = sizeof(void *);
+  size = (size + alignment - 1) & ~(alignment - 1);
+  if (size == 0)
+    size = alignment;
+  while (true) {
+#if defined(_MSC_VER)
+    void *pointer = _aligned_malloc(size, alignment);
+#else
+    void *pointer = std::aligned_alloc(alignment, size);
+#endif
+    if (pointer)
+      return pointer;
+    std::new_handler handler = std::get_new_handler();
+    if (!handler)
+      throw std::bad_alloc();
+    handler();
+  }
+}
+
+void release(void *pointer) {
+  if (!pointer)
+    return;
+  recordFree();
+  std::free(pointer);
+}
+
+void releaseAligned(void *pointer) {
+  if (!pointer)
+    return;
+  recordFree();
+#if defined(_MSC_VER)
+  _aligned_free(pointer);
+#else
+  std::free(pointer);
+#endif
+}
+
+} // namespace
+
+Scope::Scope(const char *name) : previous(currentScope) {
+  int scope = registerScope(name);
+  if (scope >= 0)
+    currentScope = scope;
+}
+
+Scope::~Scope() { currentScope = previous; }
+
+void endFrame() {
+  {
+    std::lock_guard<std::mutex> lock(frameMutex);
+    lastTotal = total.take();
+    lastScopeCount = scopeCount.load(std::memory_order_acquire);
+    for (int i = 0; i < lastScopeCount; ++i) {
+      lastScopes[i].name = scopeNames[i];
+      lastScopes[i].counters = scopeCounters[i].take();
+    }
+  }
+
+  frameNumber.fetch_add(1, std::memory_order_relaxed);
+  int frames = framesSinceWarmup.fetch_add(1, std::memory_order_relaxed) + 1;
+  armed.store(strict.load(std::memory_order_relaxed) &&
+                  frames >= warmupFrames.load(std::memory_order_relaxed),
+              std::memory_order_relaxed);
+}
+
+Counters lastFrame() {
+  std::lock_guard<std::mutex> lock(frameMutex);
+  return lastTotal;
+}
+
+int lastFrameScopes(ScopeCounters *scopes, int maxCount) {
+  std::lock_guard<std::mutex> lock(frameMutex);
+  int count = lastScopeCount < maxCount ? lastScopeCount : maxCount;
+  for (int i = 0; i < count; ++i)
+    scopes[i] = lastScopes[i];
+  return count;
+}
+
+void setStrict(bool enable, int warmup) {
+  warmupFrames = warmup;
+  strict = enable;
+  restartWarmup();
+}
+
+bool isStrict() { return strict; }
+
+void restartWarmup() {
+  framesSinceWarmup = 0;
+  armed = false;
+}
+
+} // namespace allocTracker
+
+void *operator new(std::size_t size) { return allocTracker::allocate(size); }
+void *operator new[](std::size_t size) { return allocTracker::allocate(size); }
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+  try {
+    return allocTracker::allocate(size);
+  } catch (...) {
+    return nullptr;
+  }
+}
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+  try {
+    return allocTracker::allocate(size);
+  } catch (...) {
+    return nullptr;
+  }
+}
+void *operator new(std::size_t size, std::align_val_t alignment) {
+  return allocTracker::allocateAligned(size,
+                                       static_cast<std::size_t>(alignment));
+}
+void *operator new[](std::size_t size, std::align_val_t alignment) {
+  return allocTracker::allocateAligned(size,
+                                       static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void *pointer) noexcept { allocTracker::release(pointer); }
+void operator delete[](void *pointer) noexcept {
+  allocTracker::release(pointer);
+}
+void operator delete(void *pointer, std::size_t) noexcept {
+  allocTracker::release(pointer);
+}
+void operator delete[](void *pointer, std::size_t) noexcept {
+  allocTracker::release(pointer);
+}
+void operator delete(void *pointer, const std::nothrow_t &) noexcept {
+  allocTracker::release(pointer);
+}
+void operator delete[](void *pointer, const std::nothrow_t &) noexcept {
+  allocTracker::release(pointer);
+}
+void operator delete(void *pointer, std::align_val_t) noexcept {
+  allocTracker::releaseAligned(pointer);
+}
+void operator delete[](void *pointer, std::align_val_t) noexcept {
+  allocTracker::releaseAligned(pointer);
+}
+void operator delete(void *pointer, std::size_t, std::align_val_t) noexcept {
+  allocTracker::releaseAligned(pointer);
+}
+void operator delete[](void *pointer, std::size_t, std::align_val_t) noexcept {
+  allocTracker::releaseAligned(pointer);
+}
+
+#endif // ALLOC_TRACKING
@@ -0,0 +1,87 @@
+#ifndef ALLOC_TRACKER_HPP
+#define ALLOC_TRACKER_HPP
+
+#include <cstdint>
+
+// Heap instrumentation. With ALLOC_TRACKING=1 (see CMakeLists.txt) the global
+// operator new/delete are replaced to count allocations per frame, in total
+// and per ALLOC_SCOPE. Without it every call here compiles to nothing.
+//
+// Strict mode turns any allocation made inside an ALLOC_SCOPE into an abort
+// once the frame loop has run warmupFrames frames without restartWarmup().
+// Only operator new is seen, C allocations (malloc in ImGui, GLFW, the
+// driver) are not counted.
+
+#ifndef ALLOC_TRACKING
+#define ALLOC_TRACKING 0
+#endif
+
+namespace allocTracker {
+
+struct Counters {
+  std::uint64_t allocations = 0;
+  std::uint64_t frees = 0;
+  std::uint64_t bytes = 0;
+};
+
+struct ScopeCounters {
+  const char *name = nullptr;
+  Counters counters;
+};
+
+#if ALLOC_TRACKING
+
+// Attributes allocations on this thread to name until destroyed. Scopes nest,
+// the innermost one gets the count. name must outlive the program (a literal).
+class Scope {
+public:
+  explicit Scope(const char *name);
+  ~Scope();
+
+  Scope(const Scope &) = delete;
+  Scope &operator=(const Scope &) = delete;
+
+private:
+  int previous;
+};
+
+// Closes the current frame: its counters become lastFrame() and strict mode
+// advances its warmup.
+void endFrame();
+
+Counters lastFrame();
+// Copies up to maxScopes per-scope counters of the last frame into scopes and
+// returns how many were written.
+int lastFrameScopes(ScopeCounters *scopes, int maxScopes);
+
+void setStrict(bool strict, int warmupFrames = 300);
+bool isStrict();
+// Starts the warmup over, for frames that are expected to allocate (resizes,
+// parameter changes).
+void restartWarmup();
+
+constexpr bool enabled = true;
+
+#define ALLOC_SCOPE_CONCAT2(a, b) a##b
+#define ALLOC_SCOPE_CONCAT(a, b) ALLOC_SCOPE_CONCAT2(a, b)
+#define ALLOC_SCOPE(name)                                                      \
+  allocTracker::Scope ALLOC_SCOPE_CONCAT(allocScope, __LINE__)(name)
+
+#else
+
+inline void endFrame() {}
+inline Counters lastFrame() { return Counters(); }
+inline int lastFrameScopes(ScopeCounters *, int) { return 0; }
+inline void setStrict(bool, int = 300) {}
+inline bool isStrict() { return false; }
+inline void restartWarmup() {}
+
+constexpr bool enabled = false;
+
+#define ALLOC_SCOPE(name)
+
+#endif
+
+} // namespace allocTracker
+
+#endif // ALLOC_TRACKER_HPP
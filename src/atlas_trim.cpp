@@ -0,0 +1,182 @@
+#include "atlas_trim.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+float cross(const glm::vec2 &a, const glm::vec2 &b) {
+  return a.x * b.y - a.y * b.x;
+}
+
+float polygonArea(const std::vector<glm::vec2> &polygon) {
+  float area = 0.0f;
+  for (std::size_t i = 0; i < polygon.size(); ++i)
+    area += cross(polygon[i], polygon[(i + 1) % polygon.size()]);
+  return 0.5f * std::fabs(area);
+}
+
+// Andrew's monotone chain, counter-clockwise, no collinear points.
+std::vector<glm::vec2> convexHull(std::vector<glm::vec2> points) {
+  std::sort(points.begin(), points.end(),
+            [](const glm::vec2 &a, const glm::vec2 &b) {
+              return a.x < b.x || (a.x == b.x && a.y < b.y);
+            });
+  points.erase(std::unique(points.begin(), points.end()), points.end());
+  if (points.size() < 3)
+    return points;
+
+  std::vector<glm::vec2> hull(2 * points.size());
+  std::size_t k = 0;
+  for (std::size_t i = 0; i < points.size(); ++i) {
+    while (k >= 2 &&
+           cross(hull[k - 1] - hull[k - 2], points[i] - hull[k - 2]) <= 0.0f)
+      --k;
+    hull[k++] = points[i];
+  }
+  for (std::size_t i = points.size() - 1, lower = k + 1; i > 0; --i) {
+    while (k >= lower &&
+           cross(hull[k - 1] - hull[k - 2], points[i - 1] - hull[k - 2]) <=
+               0.0f)
+      --k;
+    hull[k++] = points[i - 1];
+  }
+  hull.resize(k - 1);
+  return hull;
+}
+
+// Removes one edge at a time by extending its two neighbours until they
+// meet, picking the edge that adds the least area, until the polygon has
+// vertexCount vertices. The result still contains the hull. Intersections
+// outside the unit square are not allowed, the polygon must stay inside the
+// frame. Returns false if no further edge can be removed.
+bool reducePolygon(std::vector<glm::vec2> &polygon, std::size_t vertexCount) {
+  const float epsilon = 1e-5f;
+  while (polygon.size() > vertexCount) {
+    std::size_t n = polygon.size();
+    std::size_t bestEdge = n;
+    float bestArea = 0.0f;
+    glm::vec2 bestPoint(0.0f);
+
+    for (std::size_t i = 0; i < n; ++i) {
+      const glm::vec2 &p = polygon[(i + n - 1) % n];
+      const glm::vec2 &a = polygon[i];
+      const glm::vec2 &b = polygon[(i + 1) % n];
+      const glm::vec2 &q = polygon[(i + 2) % n];
+
+      glm::vec2 d1 = a - p;
+      glm::vec2 d2 = b - q;
+      float denominator = cross(d1, d2);
+      if (std::fabs(denominator) < 1e-12f)
+        continue;
+      // a + t * d1 == b + s * d2, both rays pointing away from the edge
+      float t = cross(b - a, d2) / denominator;
+      float s = cross(b - a, d1) / denominator;
+      if (t <= 0.0f || s <= 0.0f)
+        continue;
+
+      glm::vec2 point = a + t * d1;
+      if (point.x < -epsilon || point.y < -epsilon || point.x > 1.0f + epsilon ||
+          point.y > 1.0f + epsilon)
+        continue;
+
+      float area = 0.5f * std::fabs(cross(point - a, b - a));
+      if (bestEdge == n || area < bestArea) {
+        bestEdge = i;
+        bestArea = area;
+        bestPoint = glm::clamp(point, glm::vec2(0.0f), glm::vec2(1.0f));
+      }
+    }
+
+    if (bestEdge == n)
+      return false;
+
+    polygon[bestEdge] = bestPoint;
+    polygon.erase(polygon.begin() + (bestEdge + 1) % n);
+  }
+  return true;
+}
+
+} // namespace
+
+AtlasTrim buildAtlasTrim(const unsigned char *rgba, int width, int height,
+                         int rows, int verticesPerFrame,
+                         unsigned char alphaThreshold) {
+  AtlasTrim trim;
+  trim.rows = rows;
+  trim.verticesPerFrame = std::max(4, verticesPerFrame);
+
+  const int frames = rows * rows;
+  const int cellWidth = width / rows;
+  const int cellHeight = height / rows;
+  const std::vector<glm::vec2> fullQuad = {
+      {0.0f, 0.0f}, {1.0f, 0.0f}, {1.0f, 1.0f}, {0.0f, 1.0f}};
+
+  float totalArea = 0.0f;
+  std::vector<glm::vec2> corners;
+  for (int frame = 0; frame < frames; ++frame) {
+    // Visible texels of this frame and the next, each as its square grown
+    // by half a texel for the bilinear footprint. Only the outermost texel
+    // of each row can be on the hull.
+    corners.clear();
+    int next = std::min(frame + 1, frames - 1);
+    auto visible = [&](int x, int y) {
+      for (int source : {frame, next}) {
+        int px = (source % rows) * cellWidth + x;
+        int py = (source / rows) * cellHeight + y;
+        if (rgba[(static_cast<std::size_t>(py) * width + px) * 4 + 3] >
+            alphaThreshold)
+          return true;
+      }
+      return false;
+    };
+    auto addTexel = [&](int x, int y) {
+      float x0 = std::max(0.0f, (x - 0.5f) / cellWidth);
+      float y0 = std::max(0.0f, (y - 0.5f) / cellHeight);
+      float x1 = std::min(1.0f, (x + 1.5f) / cellWidth);
+      float y1 = std::min(1.0f, (y + 1.5f) / cellHeight);
+      corners.push_back({x0, y0});
+      corners.push_back({x1, y0});
+      corners.push_back({x1, y1});
+      corners.push_back({x0, y1});
+    };
+    for (int y = 0; y < cellHeight; ++y) {
+      int first = 0;
+      while (first < cellWidth && !visible(first, y))
+        ++first;
+      if (first == cellWidth)
+        continue;
+      int last = cellWidth - 1;
+      while (!visible(last, y))
+        --last;
+      addTexel(first, y);
+      addTexel(last, y);
+    }
+
+    std::vector<glm::vec2> polygon = convexHull(corners);
+    if (polygon.size() >= 3 &&
+        !reducePolygon(polygon, static_cast<std::size_t>(trim.verticesPerFrame)))
+      polygon = fullQuad;
+    if (polygon.empty())
+      polygon.push_back(glm::vec2(0.0f)); // nothing visible, degenerate
+
+    totalArea += polygon.size() >= 3 ? polygonArea(polygon) : 0.0f;
+    polygon.resize(trim.verticesPerFrame, polygon.back());
+    trim.vertices.insert(trim.vertices.end(), polygon.begin(), polygon.end());
+  }
+
+  trim.areaRatio = frames > 0 ? totalArea / frames : 1.0f;
+  return trim;
+}
+
+GLuint uploadAtlasTrim(const AtlasTrim &trim) {
+  GLuint buffer;
+  glGenBuffers(1, &buffer);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+  glBufferData(GL_SHADER_STORAGE_BUFFER,
+               trim.vertices.size() * sizeof(glm::vec2), trim.vertices.data(),
+               GL_STATIC_DRAW);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, trimPolygonsBinding, buffer);
+  return buffer;
+}
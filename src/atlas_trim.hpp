@@ -0,0 +1,34 @@
+#ifndef ATLAS_TRIM_HPP
+#define ATLAS_TRIM_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+// Tight convex polygons around the visible texels of each flipbook frame, so
+// particles rasterize less empty area than a full quad. Frame i's polygon
+// covers frames i and i + 1, since a particle blends the two. Vertices are in
+// the frame's own texture coordinates ([0, 1], same orientation as the quad's
+// texCoords), counter-clockwise, padded by repeating the last vertex.
+struct AtlasTrim {
+  int rows = 0;
+  int verticesPerFrame = 0;
+  // rows * rows * verticesPerFrame
+  std::vector<glm::vec2> vertices;
+  // Average polygon area over all frames; a full quad is 1.
+  float areaRatio = 1.0f;
+};
+
+// rgba is width * height RGBA8, rows * rows frames. Texels with alpha above
+// alphaThreshold count as visible. verticesPerFrame should be 6 to 8.
+AtlasTrim buildAtlasTrim(const unsigned char *rgba, int width, int height,
+                         int rows, int verticesPerFrame = 8,
+                         unsigned char alphaThreshold = 2);
+
+// Uploads the polygons as the TrimPolygons storage buffer of system.vert
+// (binding trimPolygonsBinding) and leaves it bound there.
+GLuint uploadAtlasTrim(const AtlasTrim &trim);
+
+inline constexpr GLuint trimPolygonsBinding = 2;
+
+#endif // ATLAS_TRIM_HPP
@@ -50,6 +50,17 @@ public:
         return Position;
     }
 
+    // Turns the camera towards target, keeping it level.
+    void LookAt(glm::vec3 target) {
+        glm::vec3 direction = target - Position;
+        if (glm::length(direction) <= 0.0f)
+            return;
+        direction = glm::normalize(direction);
+        Yaw = glm::degrees(atan2f(direction.z, direction.x));
+        Pitch = glm::clamp(glm::degrees(asinf(direction.y)), -89.0f, 89.0f);
+        updateCameraVectors();
+    }
+
     void ProcessKeyboard(Camera_Movement direction, float deltaTime) {
         float velocity = MovementSpeed * deltaTime;
         if (direction == FORWARD)
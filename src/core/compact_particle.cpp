@@ -0,0 +1,59 @@
+#include "compact_particle.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/constants.hpp>
+
+void CompactParticle::activate(const glm::vec3 &position,
+                               const glm::vec3 &velocity, float lifeLength,
+                               float rotation, float scale,
+                               float averageScale) {
+  this->position[0] = position.x;
+  this->position[1] = position.y;
+  this->position[2] = position.z;
+  this->velocity[0] = floatToHalf(velocity.x);
+  this->velocity[1] = floatToHalf(velocity.y);
+  this->velocity[2] = floatToHalf(velocity.z);
+  this->age = 0;
+
+  // Never store 0 for a live particle, that marks the slot as free.
+  float lifetimeMs = std::round(std::clamp(lifeLength, 0.0f, maxLifetime) * 1000.0f);
+  this->lifetime = static_cast<std::uint16_t>(std::max(lifetimeMs, 1.0f));
+
+  float turns = rotation / glm::two_pi<float>();
+  turns -= std::floor(turns);
+  this->rotation = static_cast<std::uint8_t>(static_cast<int>(turns * 256.0f) & 0xff);
+
+  float octaves = averageScale > 0.0f && scale > 0.0f
+                      ? std::log2(scale / averageScale)
+                      : -128.0f / scaleStepsPerOctave;
+  float code = std::round(128.0f + octaves * scaleStepsPerOctave);
+  this->scale = static_cast<std::uint8_t>(std::clamp(code, 0.0f, 255.0f));
+}
+
+glm::vec3 CompactParticle::getPosition() const {
+  return glm::vec3(position[0], position[1], position[2]);
+}
+
+float CompactParticle::getRotation() const {
+  return rotation * (glm::two_pi<float>() / 256.0f);
+}
+
+float CompactParticle::getScale(float averageScale) const {
+  return averageScale *
+         std::exp2((static_cast<float>(scale) - 128.0f) / scaleStepsPerOctave);
+}
+
+FlipbookFrame flipbookFrame(float lifeFactor, unsigned int textureRows) {
+  float totalStages = static_cast<float>(textureRows * textureRows);
+  float atlasProgression = lifeFactor * totalStages;
+
+  FlipbookFrame frame;
+  frame.currentTextureIndex =
+      static_cast<unsigned int>(std::floor(atlasProgression));
+  frame.nextTextureIndex = frame.currentTextureIndex < totalStages - 1
+                               ? frame.currentTextureIndex + 1
+                               : frame.currentTextureIndex;
+  frame.blendFactor = atlasProgression - frame.currentTextureIndex;
+  return frame;
+}
@@ -0,0 +1,120 @@
+#ifndef COMPACT_PARTICLE_HPP
+#define COMPACT_PARTICLE_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <glm/glm.hpp>
+
+// Emitter-wide values that Particle stores per particle but the compact
+// format keeps once per system.
+struct CompactParticleParams {
+  float gravityEffect;
+  float turbulenceScale;
+  float turbulenceStrength;
+  float averageScale;
+  unsigned int textureRows;
+};
+
+// 24-byte particle record for large systems:
+//   position   3 x float32
+//   velocity   3 x half float
+//   age        unorm16, elapsed time / lifetime
+//   lifetime   uint16 milliseconds, 0 marks a free slot
+//   rotation   unorm8 over one full turn
+//   scale      8-bit log2 ratio to the emitter average scale
+// Flipbook frame and blend factor are not stored, they follow from age.
+struct CompactParticle {
+  float position[3];
+  std::uint16_t velocity[3];
+  std::uint16_t age;
+  std::uint16_t lifetime;
+  std::uint8_t rotation;
+  std::uint8_t scale;
+
+  static constexpr float maxLifetime = 65.535f;
+  static constexpr float scaleStepsPerOctave = 16.0f;
+
+  void activate(const glm::vec3 &position, const glm::vec3 &velocity,
+                float lifeLength, float rotation, float scale,
+                float averageScale);
+
+  bool isActive() const { return lifetime != 0; }
+  glm::vec3 getPosition() const;
+  float getRotation() const;
+  float getScale(float averageScale) const;
+  float getLifeFactor() const { return age * (1.0f / 65535.0f); }
+};
+
+static_assert(sizeof(CompactParticle) <= 24, "CompactParticle grew past 24 bytes");
+
+struct FlipbookFrame {
+  unsigned int currentTextureIndex;
+  unsigned int nextTextureIndex;
+  float blendFactor;
+};
+
+FlipbookFrame flipbookFrame(float lifeFactor, unsigned int textureRows);
+
+// Conversions shared with the kernels. They are static so every ISA tier
+// compiles its own copy (see particle_kernels.inl).
+static inline std::uint16_t floatToHalf(float value) {
+  std::uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+
+  std::uint32_t sign = (bits >> 16) & 0x8000u;
+  std::uint32_t magnitude = bits & 0x7fffffffu;
+
+  if (magnitude >= 0x7f800000u) // inf / nan
+    return static_cast<std::uint16_t>(sign | 0x7c00u |
+                                      (magnitude > 0x7f800000u ? 0x200u : 0u));
+  if (magnitude >= 0x477ff000u) // rounds past the largest half, saturate
+    return static_cast<std::uint16_t>(sign | 0x7bffu);
+  if (magnitude < 0x38800000u) { // half subnormal or zero
+    if (magnitude < 0x33000000u)
+      return static_cast<std::uint16_t>(sign);
+    std::uint32_t mantissa = (magnitude & 0x7fffffu) | 0x800000u;
+    std::uint32_t shift = 126u - (magnitude >> 23);
+    std::uint32_t half = mantissa >> shift;
+    std::uint32_t rest = mantissa & ((1u << shift) - 1u);
+    std::uint32_t halfway = 1u << (shift - 1u);
+    if (rest > halfway || (rest == halfway && (half & 1u)))
+      ++half;
+    return static_cast<std::uint16_t>(sign | half);
+  }
+
+  // Normal: rebias the exponent and round the mantissa to nearest even.
+  std::uint32_t half = (magnitude - 0x38000000u) >> 13;
+  std::uint32_t rest = magnitude & 0x1fffu;
+  if (rest > 0x1000u || (rest == 0x1000u && (half & 1u)))
+    ++half;
+  return static_cast<std::uint16_t>(sign | half);
+}
+
+static inline float halfToFloat(std::uint16_t value) {
+  std::uint32_t sign = static_cast<std::uint32_t>(value & 0x8000u) << 16;
+  std::uint32_t exponent = (value >> 10) & 0x1fu;
+  std::uint32_t mantissa = value & 0x3ffu;
+
+  std::uint32_t bits;
+  if (exponent == 0x1fu) {
+    bits = sign | 0x7f800000u | (mantissa << 13);
+  } else if (exponent != 0) {
+    bits = sign | ((exponent + 112u) << 23) | (mantissa << 13);
+  } else if (mantissa != 0) {
+    // Subnormal half, normalize into a float.
+    exponent = 113u;
+    while (!(mantissa & 0x400u)) {
+      mantissa <<= 1;
+      --exponent;
+    }
+    bits = sign | (exponent << 23) | ((mantissa & 0x3ffu) << 13);
+  } else {
+    bits = sign;
+  }
+
+  float result;
+  std::memcpy(&result, &bits, sizeof(result));
+  return result;
+}
+
+#endif // COMPACT_PARTICLE_HPP
@@ -0,0 +1,138 @@
+#include "cpu_dispatch.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+namespace cpu {
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+static Tier detectHostTier() {
+  int info[4];
+  __cpuid(info, 0);
+  int maxLeaf = info[0];
+
+  __cpuid(info, 1);
+  bool sse42 = (info[2] & (1 << 20)) != 0;
+  bool fma = (info[2] & (1 << 12)) != 0;
+  bool osxsave = (info[2] & (1 << 27)) != 0;
+  bool avx = (info[2] & (1 << 28)) != 0;
+
+  // The OS has to save the YMM/ZMM state on context switches as well.
+  unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+  bool ymmState = (xcr0 & 0x6) == 0x6;
+  bool zmmState = (xcr0 & 0xe6) == 0xe6;
+
+  bool avx2 = false;
+  bool avx512 = false;
+  if (maxLeaf >= 7) {
+    __cpuidex(info, 7, 0);
+    avx2 = (info[1] & (1 << 5)) != 0;
+    bool avx512f = (info[1] & (1 << 16)) != 0;
+    bool avx512dq = (info[1] & (1 << 17)) != 0;
+    bool avx512bw = (info[1] & (1 << 30)) != 0;
+    bool avx512vl = (info[1] & (1u << 31)) != 0;
+    avx512 = avx512f && avx512dq && avx512bw && avx512vl;
+  }
+
+  if (avx && avx2 && fma && ymmState && avx512 && zmmState)
+    return Tier::AVX512;
+  if (avx && avx2 && fma && ymmState)
+    return Tier::AVX2;
+  if (sse42)
+    return Tier::SSE42;
+  return Tier::SSE2;
+}
+#elif (defined(__GNUC__) || defined(__clang__)) &&                            \
+    (defined(__x86_64__) || defined(__i386__))
+static Tier detectHostTier() {
+  // libgcc/compiler-rt already check XCR0 for the AVX state bits.
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq") &&
+      __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vl") &&
+      __builtin_cpu_supports("fma"))
+    return Tier::AVX512;
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    return Tier::AVX2;
+  if (__builtin_cpu_supports("sse4.2"))
+    return Tier::SSE42;
+  return Tier::SSE2;
+}
+#else
+// Not x86: every kernel file is built without ISA flags, so the baseline
+// table is the only meaningful one.
+static Tier detectHostTier() { return Tier::SSE2; }
+#endif
+
+static bool parseTier(const char *name, Tier &tier) {
+  if (!strcmp(name, "sse2")) {
+    tier = Tier::SSE2;
+  } else if (!strcmp(name, "sse4.2") || !strcmp(name, "sse42")) {
+    tier = Tier::SSE42;
+  } else if (!strcmp(name, "avx2")) {
+    tier = Tier::AVX2;
+  } else if (!strcmp(name, "avx512")) {
+    tier = Tier::AVX512;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+Tier detectTier() {
+  static const Tier tier = detectHostTier();
+  return tier;
+}
+
+static Tier resolveActiveTier() {
+  Tier detected = detectTier();
+
+  const char *requested = std::getenv("PARTICLE_CPU_TIER");
+  if (!requested || !*requested)
+    return detected;
+
+  Tier tier;
+  if (!parseTier(requested, tier)) {
+    std::cerr << "Unknown PARTICLE_CPU_TIER '" << requested << "', using "
+              << tierName(detected) << std::endl;
+    return detected;
+  }
+  if (tier > detected) {
+    std::cerr << "PARTICLE_CPU_TIER " << tierName(tier)
+              << " is not supported by this CPU, using " << tierName(detected)
+              << std::endl;
+    return detected;
+  }
+  return tier;
+}
+
+Tier activeTier() {
+  static const Tier tier = resolveActiveTier();
+  return tier;
+}
+
+const char *tierName(Tier tier) {
+  switch (tier) {
+  case Tier::SSE2:
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) ||           \
+    defined(_M_IX86)
+    return "sse2";
+#else
+    return "generic";
+#endif
+  case Tier::SSE42:
+    return "sse4.2";
+  case Tier::AVX2:
+    return "avx2";
+  case Tier::AVX512:
+    return "avx512";
+  }
+  return "unknown";
+}
+
+} // namespace cpu
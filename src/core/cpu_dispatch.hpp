@@ -0,0 +1,20 @@
+#ifndef CPU_DISPATCH_HPP
+#define CPU_DISPATCH_HPP
+
+namespace cpu {
+// Instruction set tiers the simulation kernels are compiled for. Ordered, so
+// a host supporting a tier supports every tier below it.
+enum class Tier { SSE2 = 0, SSE42, AVX2, AVX512 };
+
+// Best tier the host CPU (and OS) supports.
+Tier detectTier();
+
+// Tier the kernels run with: detectTier(), optionally lowered through the
+// PARTICLE_CPU_TIER environment variable (sse2, sse4.2, avx2, avx512).
+// Resolved once and cached.
+Tier activeTier();
+
+const char *tierName(Tier tier);
+} // namespace cpu
+
+#endif // CPU_DISPATCH_HPP
@@ -0,0 +1,215 @@
+#include "cpu_profiler.hpp"
+
+#if CPU_PROFILING
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace cpuProfiler {
+
+namespace {
+
+struct Event {
+  const char *name;
+  std::uint64_t start;
+  std::uint64_t end;
+};
+
+const int maxThreads = 64;
+const std::size_t eventsPerThread = 1 << 16;
+
+// Written only by its thread. A capture bumps the global generation, and a
+// thread that sees a newer one starts its buffer over; the trace writer only
+// reads buffers of the current generation, up to their published count.
+struct ThreadBuffer {
+  std::atomic<std::uint64_t> generation;
+  std::atomic<std::size_t> count;
+  std::atomic<std::uint64_t> dropped;
+  std::atomic<const char *> name;
+  int id;
+  Event events[eventsPerThread];
+};
+
+std::atomic<bool> capturing{false};
+std::atomic<std::uint64_t> generation{0};
+std::atomic<int> threadCount{0};
+std::atomic<ThreadBuffer *> threads[maxThreads];
+
+thread_local ThreadBuffer *localBuffer = nullptr;
+thread_local const char *localName = nullptr;
+
+// Capture state, main thread only.
+struct Capture {
+  bool pending = false;
+  bool active = false;
+  std::uint64_t firstFrame = 0;
+  int frameCount = 0;
+  char path[512] = {};
+};
+Capture capture;
+std::uint64_t frame = 0;
+std::uint64_t captureStart = 0;
+std::uint64_t lastFrameEnd = 0;
+
+std::uint64_t now() {
+  return static_cast<std::uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+
+ThreadBuffer *registerThread() {
+  int id = threadCount.fetch_add(1);
+  if (id >= maxThreads)
+    return nullptr;
+  // malloc rather than new: a capture must not trip --alloc-strict.
+  void *memory = std::malloc(sizeof(ThreadBuffer));
+  if (!memory)
+    return nullptr;
+  ThreadBuffer *buffer = new (memory) ThreadBuffer();
+  buffer->id = id;
+  buffer->name.store(localName, std::memory_order_relaxed);
+  threads[id].store(buffer, std::memory_order_release);
+  return buffer;
+}
+
+void record(const char *name, std::uint64_t start, std::uint64_t end) {
+  ThreadBuffer *buffer = localBuffer;
+  if (!buffer) {
+    if (threadCount.load(std::memory_order_relaxed) >= maxThreads)
+      return;
+    buffer = localBuffer = registerThread();
+    if (!buffer)
+      return;
+  }
+
+  std::uint64_t current = generation.load(std::memory_order_acquire);
+  if (buffer->generation.load(std::memory_order_relaxed) != current) {
+    buffer->count.store(0, std::memory_order_relaxed);
+    buffer->dropped.store(0, std::memory_order_relaxed);
+    buffer->generation.store(current, std::memory_order_release);
+  }
+  std::size_t count = buffer->count.load(std::memory_order_relaxed);
+  if (count == eventsPerThread) {
+    buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  buffer->events[count] = {name, start, end};
+  buffer->count.store(count + 1, std::memory_order_release);
+}
+
+void startCapture() {
+  capture.pending = false;
+  capture.active = true;
+  capture.firstFrame = frame;
+  generation.fetch_add(1, std::memory_order_release);
+  captureStart = lastFrameEnd = now();
+  capturing.store(true, std::memory_order_relaxed);
+}
+
+void writeTrace() {
+  std::FILE *file = std::fopen(capture.path, "w");
+  if (!file) {
+    std::fprintf(stderr, "Trace: cannot write %s\n", capture.path);
+    return;
+  }
+
+  std::uint64_t current = generation.load(std::memory_order_relaxed);
+  std::uint64_t events = 0, dropped = 0;
+  bool first = true;
+  std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  int count = std::min(threadCount.load(), maxThreads);
+  for (int i = 0; i < count; ++i) {
+    ThreadBuffer *buffer = threads[i].load(std::memory_order_acquire);
+    if (!buffer ||
+        buffer->generation.load(std::memory_order_acquire) != current)
+      continue;
+
+    const char *name = buffer->name.load(std::memory_order_relaxed);
+    std::fprintf(file,
+                 "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                 "\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                 first ? "" : ",\n", buffer->id, name ? name : "thread");
+    first = false;
+
+    std::size_t written = buffer->count.load(std::memory_order_acquire);
+    for (std::size_t e = 0; e < written; ++e) {
+      const Event &event = buffer->events[e];
+      std::fprintf(file,
+                   ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+                   "\"ts\":%.3f,\"dur\":%.3f}",
+                   event.name, buffer->id,
+                   (event.start - captureStart) / 1000.0,
+                   (event.end - event.start) / 1000.0);
+    }
+    events += written;
+    dropped += buffer->dropped.load(std::memory_order_relaxed);
+  }
+  std::fprintf(file, "\n]}\n");
+  std::fclose(file);
+
+  std::printf("Trace: frames %llu-%llu, %llu events (%llu dropped) written "
+              "to %s\n",
+              static_cast<unsigned long long>(capture.firstFrame),
+              static_cast<unsigned long long>(frame - 1),
+              static_cast<unsigned long long>(events),
+              static_cast<unsigned long long>(dropped), capture.path);
+}
+
+} // namespace
+
+Zone::Zone(const char *name)
+    : name(name),
+      start(capturing.load(std::memory_order_relaxed) ? now() : 0) {}
+
+Zone::~Zone() {
+  if (start)
+    record(name, start, now());
+}
+
+void setThreadName(const char *name) {
+  localName = name;
+  if (localBuffer)
+    localBuffer->name.store(name, std::memory_order_relaxed);
+}
+
+void requestCapture(std::uint64_t firstFrame, int frameCount,
+                    const char *path) {
+  if (capture.active || frameCount <= 0)
+    return;
+  capture.firstFrame = firstFrame;
+  capture.frameCount = frameCount;
+  std::snprintf(capture.path, sizeof(capture.path), "%s", path);
+  capture.pending = true;
+  if (firstFrame <= frame)
+    startCapture();
+}
+
+bool isCapturing() { return capture.active; }
+
+void endFrame() {
+  if (capture.active) {
+    std::uint64_t end = now();
+    record("frame", lastFrameEnd, end);
+    lastFrameEnd = end;
+  }
+  ++frame;
+  if (capture.active &&
+      frame >= capture.firstFrame + capture.frameCount) {
+    capturing.store(false, std::memory_order_relaxed);
+    capture.active = false;
+    writeTrace();
+  }
+  if (capture.pending && frame >= capture.firstFrame)
+    startCapture();
+}
+
+std::uint64_t frameIndex() { return frame; }
+
+} // namespace cpuProfiler
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef CPU_PROFILER_HPP
+#define CPU_PROFILER_HPP
+
+#include <cstdint>
+
+// Scope profiler. PROFILE_ZONE(name) records the time spent in the enclosing
+// block on the calling thread while a capture is running; captures cover a
+// range of frames (see endFrame()) and are written as Chrome trace-event
+// JSON, which chrome://tracing and ui.perfetto.dev open.
+//
+// Each thread appends to its own fixed-size buffer, so recording takes no
+// lock. Outside a capture a zone is one relaxed load and a branch, and with
+// CPU_PROFILING=0 (see CMakeLists.txt) zones compile to nothing.
+
+#ifndef CPU_PROFILING
+#define CPU_PROFILING 0
+#endif
+
+namespace cpuProfiler {
+
+#if CPU_PROFILING
+
+class Zone {
+public:
+  // name must outlive the program (a literal).
+  explicit Zone(const char *name);
+  ~Zone();
+
+  Zone(const Zone &) = delete;
+  Zone &operator=(const Zone &) = delete;
+
+private:
+  const char *name;
+  std::uint64_t start;
+};
+
+// Label for the calling thread in the trace.
+void setThreadName(const char *name);
+
+// Captures frames [firstFrame, firstFrame + frameCount) of the frame counter
+// advanced by endFrame() and writes them to path once the last one ends.
+// Replaces a capture that has not started yet.
+void requestCapture(std::uint64_t firstFrame, int frameCount,
+                    const char *path);
+bool isCapturing();
+
+// Ends the current frame of the main loop.
+void endFrame();
+std::uint64_t frameIndex();
+
+constexpr bool enabled = true;
+
+#define PROFILE_ZONE_CONCAT2(a, b) a##b
+#define PROFILE_ZONE_CONCAT(a, b) PROFILE_ZONE_CONCAT2(a, b)
+#define PROFILE_ZONE(name)                                                     \
+  cpuProfiler::Zone PROFILE_ZONE_CONCAT(profileZone, __LINE__)(name)
+
+#else
+
+inline void setThreadName(const char *) {}
+inline void requestCapture(std::uint64_t, int, const char *) {}
+inline bool isCapturing() { return false; }
+inline void endFrame() {}
+inline std::uint64_t frameIndex() { return 0; }
+
+constexpr bool enabled = false;
+
+#define PROFILE_ZONE(name)
+
+#endif
+
+} // namespace cpuProfiler
+
+#endif // CPU_PROFILER_HPP
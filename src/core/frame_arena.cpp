@@ -0,0 +1,103 @@
+#include "frame_arena.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <new>
+
+FrameArena::FrameArena(const char *name, std::size_t blockSize)
+    : name(name), blockSize(blockSize) {}
+
+FrameArena::~FrameArena() {
+#ifndef NDEBUG
+  if (highWaterMark > 0) {
+    std::cerr << "Frame arena '" << name
+              << "' high-water mark: " << highWaterMark / 1024.0 << " KB"
+              << std::endl;
+  }
+#endif
+}
+
+void *FrameArena::allocate(std::size_t bytes, std::size_t alignment) {
+  if (blocks.empty())
+    addBlock(bytes + alignment);
+
+  while (true) {
+    Block &block = blocks[current];
+    std::uintptr_t base = reinterpret_cast<std::uintptr_t>(block.memory.get());
+    std::uintptr_t aligned = (base + offset + alignment - 1) & ~(alignment - 1);
+    std::size_t end = aligned - base + bytes;
+    if (end <= block.size) {
+      offset = end;
+      highWaterMark = std::max(highWaterMark, usedInFullBlocks + offset);
+      return reinterpret_cast<void *>(aligned);
+    }
+
+    usedInFullBlocks += offset;
+    offset = 0;
+    // Only chaining grows the arena, so the bump path above needs no check.
+    if (usedInFullBlocks + bytes > limit && !limitReported) {
+      limitReported = true;
+      std::cerr << "Frame arena '" << name << "' holds "
+                << (usedInFullBlocks + bytes) / (1024.0 * 1024.0)
+                << " MB since its last reset(); is reset() called every "
+                   "frame on this thread?"
+                << std::endl;
+      assert(!"frame arena limit exceeded");
+    }
+    if (++current == blocks.size())
+      addBlock(bytes + alignment);
+  }
+}
+
+void FrameArena::deallocate(void *pointer, std::size_t bytes) {
+  unsigned char *top = blocks[current].memory.get() + offset;
+  if (static_cast<unsigned char *>(pointer) + bytes == top)
+    offset -= bytes;
+}
+
+void FrameArena::reset() {
+  // More than one block means the frame outgrew the arena; replace them by
+  // one block that fits everything so the next frame bumps through it.
+  if (blocks.size() > 1) {
+    std::size_t total = 0;
+    for (const Block &block : blocks)
+      total += block.size;
+    blocks.clear();
+    addBlock(total);
+  }
+
+  current = 0;
+  offset = 0;
+  usedInFullBlocks = 0;
+}
+
+std::size_t FrameArena::getUsed() const { return usedInFullBlocks + offset; }
+
+std::size_t FrameArena::getCapacity() const {
+  std::size_t total = 0;
+  for (const Block &block : blocks)
+    total += block.size;
+  return total;
+}
+
+std::size_t FrameArena::getHighWaterMark() const { return highWaterMark; }
+
+void FrameArena::setName(const char *name) { this->name = name; }
+
+void FrameArena::setLimit(std::size_t bytes) { limit = bytes; }
+
+std::size_t FrameArena::getLimit() const { return limit; }
+
+FrameArena &FrameArena::local() {
+  thread_local FrameArena arena;
+  return arena;
+}
+
+void FrameArena::addBlock(std::size_t minimumSize) {
+  Block block;
+  block.size = std::max(blockSize, minimumSize);
+  block.memory.reset(new unsigned char[block.size]);
+  blocks.push_back(std::move(block));
+}
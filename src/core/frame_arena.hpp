@@ -0,0 +1,106 @@
+#ifndef FRAME_ARENA_HPP
+#define FRAME_ARENA_HPP
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Bump allocator for data that lives at most one frame (sort keys, index
+// permutations, spawn batches, ...). Each thread has its own arena via
+// local(); the thread that owns it calls reset() once its frame is done,
+// after every container allocated from it has been destroyed.
+//
+// Every thread that allocates through local(), directly or through
+// FrameVector (ParticleSystem::update() does), must call reset() once per
+// frame or per step. Memory is only reclaimed there: without it the arena
+// grows for as long as the thread runs. Past getLimit() bytes in use since
+// the last reset() the arena warns once, and asserts in debug builds.
+//
+// Running out of space chains another block; reset() folds all blocks into
+// a single one big enough for the whole frame, so in steady state a frame
+// costs no heap allocations at all.
+class FrameArena {
+public:
+  explicit FrameArena(const char *name = "frame", std::size_t blockSize = 256 * 1024);
+  ~FrameArena();
+
+  FrameArena(const FrameArena &) = delete;
+  FrameArena &operator=(const FrameArena &) = delete;
+
+  void *allocate(std::size_t bytes, std::size_t alignment);
+  // Only the most recent allocation of the current block is actually
+  // returned to the arena, which covers the usual grow-a-vector pattern.
+  // Anything freed out of order, or from a block the arena has since chained
+  // past, waits for reset().
+  void deallocate(void *pointer, std::size_t bytes);
+
+  void reset();
+
+  std::size_t getUsed() const;
+  std::size_t getCapacity() const;
+  // Most bytes in use at any point since the arena was created.
+  std::size_t getHighWaterMark() const;
+
+  void setName(const char *name);
+
+  // Bytes in use between two reset() calls beyond which the arena reports a
+  // missing reset(); 256 MB by default.
+  void setLimit(std::size_t bytes);
+  std::size_t getLimit() const;
+
+  // Arena of the calling thread.
+  static FrameArena &local();
+
+private:
+  struct Block {
+    std::unique_ptr<unsigned char[]> memory;
+    std::size_t size;
+  };
+
+  void addBlock(std::size_t minimumSize);
+
+  const char *name;
+  std::size_t blockSize;
+  std::vector<Block> blocks;
+  std::size_t current = 0; // index into blocks
+  std::size_t offset = 0;  // bump pointer within blocks[current]
+  std::size_t usedInFullBlocks = 0;
+  std::size_t highWaterMark = 0;
+  std::size_t limit = 256 * 1024 * 1024;
+  bool limitReported = false;
+};
+
+// Standard allocator adaptor over a FrameArena, defaults to the calling
+// thread's arena.
+template <typename T> class FrameAllocator {
+public:
+  using value_type = T;
+
+  FrameAllocator() noexcept : arena(&FrameArena::local()) {}
+  explicit FrameAllocator(FrameArena &arena) noexcept : arena(&arena) {}
+  template <typename U>
+  FrameAllocator(const FrameAllocator<U> &other) noexcept
+      : arena(other.arena) {}
+
+  T *allocate(std::size_t count) {
+    return static_cast<T *>(arena->allocate(count * sizeof(T), alignof(T)));
+  }
+  void deallocate(T *pointer, std::size_t count) noexcept {
+    arena->deallocate(pointer, count * sizeof(T));
+  }
+
+  template <typename U> bool operator==(const FrameAllocator<U> &other) const {
+    return arena == other.arena;
+  }
+  template <typename U> bool operator!=(const FrameAllocator<U> &other) const {
+    return arena != other.arena;
+  }
+
+private:
+  template <typename U> friend class FrameAllocator;
+  FrameArena *arena;
+};
+
+template <typename T> using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+#endif // FRAME_ARENA_HPP
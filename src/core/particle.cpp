@@ -0,0 +1,41 @@
+#include "particle.hpp"
+#include "particle_kernels.hpp"
+
+void Particle::activate(const glm::vec3 &position, const glm::vec3 &velocity,
+                        float gravityEffect, float lifeLength, float rotation,
+                        float scale, unsigned int textureRows,
+                        float turbulenceScale, float turbulenceStrength) {
+  this->position = position;
+  this->velocity = velocity;
+  this->gravityEffect = gravityEffect;
+  this->lifeLength = lifeLength;
+  this->rotation = rotation;
+  this->scale = scale;
+  this->elapsedTime = 0.0f;
+  this->active = true;
+  this->textureRows = textureRows;
+  this->turbulenceScale = turbulenceScale;
+  this->turbulenceStrength = turbulenceStrength;
+}
+
+bool Particle::update(float deltaTime, const glm::vec3 &cameraPosition) {
+  if (!active)
+    return false;
+
+  // Loose particles have no system to own a flicker stream; one per thread
+  // keeps them off any shared state.
+  thread_local std::uint32_t random = 1;
+  particleKernels().update(this, 1, deltaTime, random);
+  return active;
+}
+
+const glm::vec3 &Particle::getPosition() const { return position; }
+float Particle::getRotation() const { return rotation; }
+float Particle::getScale() const { return scale; }
+float Particle::getLifeFactor() const { return elapsedTime / lifeLength; }
+bool Particle::isActive() const { return active; }
+unsigned int Particle::getCurrentTextureIndex() const {
+  return currentTextureIndex;
+}
+unsigned int Particle::getNextTextureIndex() const { return nextTextureIndex; }
+float Particle::getBlendFactor() const { return blendFactor; }
@@ -3,6 +3,9 @@
 
 #include <glm/glm.hpp>
 
+// Per-ISA simulation kernels, see particle_kernels.inl.
+template <typename Isa> struct ParticleKernelImpl;
+
 class Particle {
 public:
   void activate(const glm::vec3 &position, const glm::vec3 &velocity,
@@ -22,6 +25,8 @@ public:
   float getBlendFactor() const;
 
 private:
+  template <typename Isa> friend struct ParticleKernelImpl;
+
   glm::vec3 position;
   glm::vec3 velocity;
   float gravityEffect;
@@ -0,0 +1,35 @@
+#include "particle_frame.hpp"
+
+#include "compact_particle.hpp"
+
+#include <cmath>
+
+namespace {
+
+std::uint16_t toUnorm16(float value) {
+  value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+  return static_cast<std::uint16_t>(value * 65535.0f + 0.5f);
+}
+
+} // namespace
+
+PackedParticleInstance packInstance(const ParticleInstance &instance,
+                                    const glm::vec3 &origin) {
+  const float twoPi = 6.28318530718f;
+  glm::vec3 offset = instance.position - origin;
+  float rotation = instance.rotation - twoPi * std::floor(instance.rotation / twoPi);
+
+  PackedParticleInstance packed;
+  packed.positionXY = floatToHalf(offset.x) |
+                      static_cast<std::uint32_t>(floatToHalf(offset.y)) << 16;
+  packed.positionZScale =
+      floatToHalf(offset.z) |
+      static_cast<std::uint32_t>(floatToHalf(instance.scale)) << 16;
+  packed.rotationLife =
+      toUnorm16(rotation / twoPi) |
+      static_cast<std::uint32_t>(toUnorm16(instance.lifeFactor)) << 16;
+  packed.frameBlend =
+      (instance.currentTextureIndex & 0xffffu) |
+      static_cast<std::uint32_t>(toUnorm16(instance.blendFactor)) << 16;
+  return packed;
+}
@@ -0,0 +1,49 @@
+#ifndef PARTICLE_FRAME_HPP
+#define PARTICLE_FRAME_HPP
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+// Everything the renderer needs for one particle, resolved from either
+// storage format. Uploaded as is as the per-instance vertex attributes of
+// system.vert, so the layout is part of the shader interface.
+struct ParticleInstance {
+  glm::vec3 position;
+  float scale;
+  float rotation;
+  float blendFactor;
+  float lifeFactor;
+  unsigned int currentTextureIndex;
+  unsigned int nextTextureIndex;
+};
+
+static_assert(sizeof(ParticleInstance) == 36,
+              "ParticleInstance must stay tightly packed for instancing");
+
+// 16-byte record read by system.vert with VERTEX_PULLING from a storage
+// buffer; the quad corners come from gl_VertexID. The next flipbook frame is
+// derived in the shader.
+struct PackedParticleInstance {
+  std::uint32_t positionXY;     // half x, half y, relative to the draw origin
+  std::uint32_t positionZScale; // half z, half scale
+  std::uint32_t rotationLife;   // unorm16 rotation / 2 pi, unorm16 life
+  std::uint32_t frameBlend;     // uint16 current frame, unorm16 blend
+};
+
+static_assert(sizeof(PackedParticleInstance) == 16,
+              "PackedParticleInstance is read as four uints by system.vert");
+
+// origin is subtracted from the position before it is stored as half floats.
+PackedParticleInstance packInstance(const ParticleInstance &instance,
+                                    const glm::vec3 &origin);
+
+// Snapshot of the live particles of one simulation step, back to front.
+struct ParticleFrame {
+  std::vector<ParticleInstance> instances;
+  unsigned int textureRows = 1;
+  // Emitter position, the reference point of packed instances.
+  glm::vec3 origin = glm::vec3(0.0f);
+};
+
+#endif // PARTICLE_FRAME_HPP
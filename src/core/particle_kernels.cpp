@@ -0,0 +1,20 @@
+#include "particle_kernels.hpp"
+
+const ParticleKernels &particleKernels(cpu::Tier tier) {
+  switch (tier) {
+  case cpu::Tier::AVX512:
+    return kernels::avx512;
+  case cpu::Tier::AVX2:
+    return kernels::avx2;
+  case cpu::Tier::SSE42:
+    return kernels::sse42;
+  case cpu::Tier::SSE2:
+  default:
+    return kernels::sse2;
+  }
+}
+
+const ParticleKernels &particleKernels() {
+  static const ParticleKernels &active = particleKernels(cpu::activeTier());
+  return active;
+}
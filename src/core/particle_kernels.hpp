@@ -0,0 +1,54 @@
+#ifndef PARTICLE_KERNELS_HPP
+#define PARTICLE_KERNELS_HPP
+
+#include "cpu_dispatch.hpp"
+#include <cstddef>
+#include <cstdint>
+
+class Particle;
+struct CompactParticle;
+struct CompactParticleParams;
+
+// Hot per-particle loops. particle_kernels.inl is compiled once per ISA tier
+// (particle_kernels_<tier>.cpp, flags set in CMakeLists.txt) and the table
+// matching cpu::activeTier() is used at runtime.
+//
+// random is the caller's xorshift32 state for flicker and dither, advanced in
+// place; it must not be 0. Each ParticleSystem keeps its own, so results do
+// not depend on other threads and no lock is taken.
+struct ParticleKernels {
+  // Advances every active particle in [particles, particles + count).
+  void (*update)(Particle *particles, std::size_t count, float deltaTime,
+                 std::uint32_t &random);
+
+  // Writes the squared distance to the camera of every particle into keys.
+  void (*depthKeys)(const Particle *particles, std::size_t count,
+                    float cameraX, float cameraY, float cameraZ, float *keys);
+
+  // Same two loops for the 24-byte CompactParticle storage.
+  void (*updateCompact)(CompactParticle *particles, std::size_t count,
+                        float deltaTime, const CompactParticleParams &params,
+                        std::uint32_t &random);
+  void (*depthKeysCompact)(const CompactParticle *particles, std::size_t count,
+                           float cameraX, float cameraY, float cameraZ,
+                           float *keys);
+
+  // Sum of the three lookups of this tier's Perlin port that update() makes
+  // per particle, at each particle's position. Only for kernel_bench, which
+  // times the port on its own; update() calls it inline.
+  float (*perlinSum)(const Particle *particles, std::size_t count);
+};
+
+namespace kernels {
+extern const ParticleKernels sse2;
+extern const ParticleKernels sse42;
+extern const ParticleKernels avx2;
+extern const ParticleKernels avx512;
+} // namespace kernels
+
+const ParticleKernels &particleKernels(cpu::Tier tier);
+
+// Kernels for cpu::activeTier().
+const ParticleKernels &particleKernels();
+
+#endif // PARTICLE_KERNELS_HPP
@@ -0,0 +1,296 @@
+// Body of the per-ISA particle kernels. Included by particle_kernels_*.cpp
+// after defining PARTICLE_KERNEL_ISA (tag type name) and PARTICLE_KERNEL_TABLE
+// (name of the exported ParticleKernels table).
+//
+// Every translation unit that includes this file is compiled with different
+// target flags, so nothing in here may produce a symbol that the linker could
+// merge with another tier's copy: helpers live in an anonymous namespace, the
+// friend specialization is keyed on a per-tier tag, and glm functions (inline
+// templates, emitted as shared weak symbols) are not called. Only the layout
+// of glm::vec3 is used.
+
+#include "compact_particle.hpp"
+#include "particle.hpp"
+#include "particle_kernels.hpp"
+
+#include <math.h>
+#include <stdint.h>
+
+namespace kernels {
+struct PARTICLE_KERNEL_ISA {};
+} // namespace kernels
+
+namespace {
+
+inline float fract(float x) { return x - floorf(x); }
+inline float mod289(float x) { return x - floorf(x * (1.0f / 289.0f)) * 289.0f; }
+inline float permute(float x) { return mod289((x * 34.0f + 1.0f) * x); }
+inline float taylorInvSqrt(float r) {
+  return 1.79284291400159f - 0.85373472095314f * r;
+}
+inline float fade(float t) { return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f); }
+inline float mix(float a, float b, float t) { return a * (1.0f - t) + b * t; }
+inline float step(float edge, float x) { return x < edge ? 0.0f : 1.0f; }
+
+// xorshift32: a few shifts, no lock and no state shared with other callers,
+// unlike rand().
+inline uint32_t nextRandom(uint32_t &state) {
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+// Random offset in [0, 1) so small per-frame changes to 8-bit fields are kept
+// on average instead of always rounding away.
+inline float dither(uint32_t &state) {
+  return (nextRandom(state) >> 17) * (1.0f / 32768.0f);
+}
+
+// Scalar port of glm::perlin(vec3), the classic Perlin noise from webgl-noise.
+// The four corner lanes are plain loops so the compiler can map them onto the
+// vector width of the tier being built.
+float perlin(float x, float y, float z) {
+  float pi0[3] = {floorf(x), floorf(y), floorf(z)};
+  float pi1[3] = {pi0[0] + 1.0f, pi0[1] + 1.0f, pi0[2] + 1.0f};
+  float pf0[3] = {x - pi0[0], y - pi0[1], z - pi0[2]};
+  float pf1[3] = {pf0[0] - 1.0f, pf0[1] - 1.0f, pf0[2] - 1.0f};
+  for (int c = 0; c < 3; ++c) {
+    pi0[c] = mod289(pi0[c]);
+    pi1[c] = mod289(pi1[c]);
+  }
+
+  const float ix[4] = {pi0[0], pi1[0], pi0[0], pi1[0]};
+  const float iy[4] = {pi0[1], pi0[1], pi1[1], pi1[1]};
+
+  float gx[2][4], gy[2][4], gz[2][4];
+  for (int layer = 0; layer < 2; ++layer) {
+    float iz = layer == 0 ? pi0[2] : pi1[2];
+    for (int i = 0; i < 4; ++i) {
+      float ixy = permute(permute(ix[i]) + iy[i]);
+      float g = permute(ixy + iz) * (1.0f / 7.0f);
+      float gyl = fract(floorf(g) * (1.0f / 7.0f)) - 0.5f;
+      float gxl = fract(g);
+      float gzl = 0.5f - fabsf(gxl) - fabsf(gyl);
+      float sz = step(gzl, 0.0f);
+      gxl -= sz * (step(0.0f, gxl) - 0.5f);
+      gyl -= sz * (step(0.0f, gyl) - 0.5f);
+
+      float norm = taylorInvSqrt(gxl * gxl + gyl * gyl + gzl * gzl);
+      gx[layer][i] = gxl * norm;
+      gy[layer][i] = gyl * norm;
+      gz[layer][i] = gzl * norm;
+    }
+  }
+
+  // Corner i: bit 0 selects x, bit 1 selects y; the layer selects z.
+  float n[2][4];
+  for (int layer = 0; layer < 2; ++layer) {
+    float fz = layer == 0 ? pf0[2] : pf1[2];
+    for (int i = 0; i < 4; ++i) {
+      float fx = (i & 1) ? pf1[0] : pf0[0];
+      float fy = (i & 2) ? pf1[1] : pf0[1];
+      n[layer][i] = gx[layer][i] * fx + gy[layer][i] * fy + gz[layer][i] * fz;
+    }
+  }
+
+  float fadeX = fade(pf0[0]);
+  float fadeY = fade(pf0[1]);
+  float fadeZ = fade(pf0[2]);
+  float nz[4];
+  for (int i = 0; i < 4; ++i)
+    nz[i] = mix(n[0][i], n[1][i], fadeZ);
+  float nyz0 = mix(nz[0], nz[2], fadeY);
+  float nyz1 = mix(nz[1], nz[3], fadeY);
+  return 2.2f * mix(nyz0, nyz1, fadeX);
+}
+
+} // namespace
+
+template <> struct ParticleKernelImpl<kernels::PARTICLE_KERNEL_ISA> {
+  static void update(Particle *particles, std::size_t count, float deltaTime,
+                     uint32_t &random) {
+    // A local copy stays in a register; particles could alias the reference.
+    uint32_t state = random;
+    for (std::size_t i = 0; i < count; ++i) {
+      Particle &p = particles[i];
+      if (!p.active)
+        continue;
+
+      // bouyancy
+      float bouyancyFactor = 1.0f - p.elapsedTime / p.lifeLength;
+      p.velocity.y += (p.gravityEffect + bouyancyFactor * 2.0f) * deltaTime;
+
+      // sinusoidal horizontal sway
+      const float swingAmplitude = 0.1f;
+      const float swingFrequency = 2.0f;
+      p.position.x +=
+          sinf(p.elapsedTime * swingFrequency) * swingAmplitude * deltaTime;
+      p.position.z +=
+          cosf(p.elapsedTime * swingFrequency) * swingAmplitude * deltaTime;
+
+      // turbulence
+      float sx = p.position.x * p.turbulenceScale;
+      float sy = p.position.y * p.turbulenceScale;
+      float sz = p.position.z * p.turbulenceScale;
+      float t = p.elapsedTime;
+      float strength = p.turbulenceStrength * deltaTime;
+      p.velocity.x += perlin(sx + t, sy + t, sz + t) * strength;
+      p.velocity.y +=
+          perlin(sx + t + 100.0f, sy + t + 100.0f, sz + t + 100.0f) * strength;
+      p.velocity.z +=
+          perlin(sx + t + 200.0f, sy + t + 200.0f, sz + t + 200.0f) * strength;
+
+      p.position.x += p.velocity.x * deltaTime;
+      p.position.y += p.velocity.y * deltaTime;
+      p.position.z += p.velocity.z * deltaTime;
+      p.elapsedTime += deltaTime;
+
+      // flickering
+      uint32_t flicker = nextRandom(state);
+      float flickerScale = 0.98f + (flicker % 5) / 1000.0f;
+      float flickerRotation =
+          (static_cast<int>((flicker >> 16) % 10) - 5) * deltaTime;
+      p.scale *= flickerScale;
+      p.rotation += flickerRotation;
+
+      if (p.elapsedTime >= p.lifeLength) {
+        p.active = false;
+        continue;
+      }
+
+      // textures
+      float lifeFactor = p.elapsedTime / p.lifeLength;
+      float totalStages = static_cast<float>(p.textureRows * p.textureRows);
+      float atlasProgression = lifeFactor * totalStages;
+      p.currentTextureIndex =
+          static_cast<unsigned int>(floorf(atlasProgression));
+      p.nextTextureIndex = p.currentTextureIndex < totalStages - 1
+                               ? p.currentTextureIndex + 1
+                               : p.currentTextureIndex;
+      p.blendFactor = atlasProgression - p.currentTextureIndex;
+    }
+    random = state;
+  }
+
+  static void depthKeys(const Particle *particles, std::size_t count,
+                        float cameraX, float cameraY, float cameraZ,
+                        float *keys) {
+    for (std::size_t i = 0; i < count; ++i) {
+      float dx = particles[i].position.x - cameraX;
+      float dy = particles[i].position.y - cameraY;
+      float dz = particles[i].position.z - cameraZ;
+      keys[i] = dx * dx + dy * dy + dz * dz;
+    }
+  }
+
+  static void updateCompact(CompactParticle *particles, std::size_t count,
+                            float deltaTime,
+                            const CompactParticleParams &params,
+                            uint32_t &random) {
+    const float rotationSteps = 256.0f / 6.28318530718f;
+    uint32_t state = random;
+
+    for (std::size_t i = 0; i < count; ++i) {
+      CompactParticle &p = particles[i];
+      if (!p.lifetime)
+        continue;
+
+      float lifeLength = p.lifetime * 0.001f;
+      float lifeFactor = p.age * (1.0f / 65535.0f);
+      float elapsedTime = lifeFactor * lifeLength;
+
+      float px = p.position[0];
+      float py = p.position[1];
+      float pz = p.position[2];
+      float vx = halfToFloat(p.velocity[0]);
+      float vy = halfToFloat(p.velocity[1]);
+      float vz = halfToFloat(p.velocity[2]);
+
+      // bouyancy
+      vy += (params.gravityEffect + (1.0f - lifeFactor) * 2.0f) * deltaTime;
+
+      // sinusoidal horizontal sway
+      const float swingAmplitude = 0.1f;
+      const float swingFrequency = 2.0f;
+      px += sinf(elapsedTime * swingFrequency) * swingAmplitude * deltaTime;
+      pz += cosf(elapsedTime * swingFrequency) * swingAmplitude * deltaTime;
+
+      // turbulence
+      float sx = px * params.turbulenceScale;
+      float sy = py * params.turbulenceScale;
+      float sz = pz * params.turbulenceScale;
+      float t = elapsedTime;
+      float strength = params.turbulenceStrength * deltaTime;
+      vx += perlin(sx + t, sy + t, sz + t) * strength;
+      vy += perlin(sx + t + 100.0f, sy + t + 100.0f, sz + t + 100.0f) * strength;
+      vz += perlin(sx + t + 200.0f, sy + t + 200.0f, sz + t + 200.0f) * strength;
+
+      px += vx * deltaTime;
+      py += vy * deltaTime;
+      pz += vz * deltaTime;
+      elapsedTime += deltaTime;
+
+      // flickering, applied to the quantized fields
+      uint32_t flicker = nextRandom(state);
+      float flickerScale = 0.98f + (flicker % 5) / 1000.0f;
+      float flickerRotation =
+          (static_cast<int>((flicker >> 16) % 10) - 5) * deltaTime;
+      float scaleCode = p.scale +
+                        log2f(flickerScale) * CompactParticle::scaleStepsPerOctave +
+                        dither(state);
+      scaleCode = scaleCode < 0.0f ? 0.0f : (scaleCode > 255.0f ? 255.0f : scaleCode);
+      p.scale = static_cast<std::uint8_t>(scaleCode);
+      float rotationCode = flickerRotation * rotationSteps + dither(state);
+      p.rotation = static_cast<std::uint8_t>(
+          (p.rotation + static_cast<int>(floorf(rotationCode))) & 0xff);
+
+      p.position[0] = px;
+      p.position[1] = py;
+      p.position[2] = pz;
+      p.velocity[0] = floatToHalf(vx);
+      p.velocity[1] = floatToHalf(vy);
+      p.velocity[2] = floatToHalf(vz);
+
+      if (elapsedTime >= lifeLength) {
+        p.lifetime = 0;
+        continue;
+      }
+      p.age = static_cast<std::uint16_t>(elapsedTime / lifeLength * 65535.0f + 0.5f);
+    }
+    random = state;
+  }
+
+  static void depthKeysCompact(const CompactParticle *particles,
+                               std::size_t count, float cameraX, float cameraY,
+                               float cameraZ, float *keys) {
+    for (std::size_t i = 0; i < count; ++i) {
+      float dx = particles[i].position[0] - cameraX;
+      float dy = particles[i].position[1] - cameraY;
+      float dz = particles[i].position[2] - cameraZ;
+      keys[i] = dx * dx + dy * dy + dz * dz;
+    }
+  }
+
+  static float perlinSum(const Particle *particles, std::size_t count) {
+    float sum = 0.0f;
+    for (std::size_t i = 0; i < count; ++i) {
+      float x = particles[i].position.x;
+      float y = particles[i].position.y;
+      float z = particles[i].position.z;
+      sum += perlin(x, y, z) + perlin(x + 100.0f, y + 100.0f, z + 100.0f) +
+             perlin(x + 200.0f, y + 200.0f, z + 200.0f);
+    }
+    return sum;
+  }
+};
+
+namespace kernels {
+const ParticleKernels PARTICLE_KERNEL_TABLE = {
+    &ParticleKernelImpl<PARTICLE_KERNEL_ISA>::update,
+    &ParticleKernelImpl<PARTICLE_KERNEL_ISA>::depthKeys,
+    &ParticleKernelImpl<PARTICLE_KERNEL_ISA>::updateCompact,
+    &ParticleKernelImpl<PARTICLE_KERNEL_ISA>::depthKeysCompact,
+    &ParticleKernelImpl<PARTICLE_KERNEL_ISA>::perlinSum,
+};
+} // namespace kernels
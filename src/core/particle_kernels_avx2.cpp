@@ -0,0 +1,4 @@
+// Kernels built for AVX2 and FMA, see CMakeLists.txt.
+#define PARTICLE_KERNEL_ISA Avx2
+#define PARTICLE_KERNEL_TABLE avx2
+#include "particle_kernels.inl"
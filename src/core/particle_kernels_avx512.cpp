@@ -0,0 +1,4 @@
+// Kernels built for AVX-512 (F/DQ/BW/VL), see CMakeLists.txt.
+#define PARTICLE_KERNEL_ISA Avx512
+#define PARTICLE_KERNEL_TABLE avx512
+#include "particle_kernels.inl"
@@ -0,0 +1,4 @@
+// Kernels built for baseline x86-64 (SSE2), see CMakeLists.txt.
+#define PARTICLE_KERNEL_ISA Sse2
+#define PARTICLE_KERNEL_TABLE sse2
+#include "particle_kernels.inl"
@@ -0,0 +1,4 @@
+// Kernels built for SSE4.2, see CMakeLists.txt.
+#define PARTICLE_KERNEL_ISA Sse42
+#define PARTICLE_KERNEL_TABLE sse42
+#include "particle_kernels.inl"
@@ -0,0 +1,53 @@
+#include "particle_math.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+glm::vec3 unitVectorFromSamples(float u0, float u1) {
+  float theta = u0 * 2.0f * glm::pi<float>();
+  float z = (u1 * 2.0f) - 1.0f;
+  float rootOneMinusZSquared = sqrtf(1 - z * z);
+  float x = rootOneMinusZSquared * cosf(theta);
+  float y = rootOneMinusZSquared * sinf(theta);
+  return glm::vec3(x, y, z);
+}
+
+glm::vec3 unitVectorWithinCone(const glm::vec3 &coneDirection, float angle,
+                               float u0, float u1) {
+  float cosAngle = cosf(angle);
+  float theta = u0 * 2.0f * glm::pi<float>();
+  float z = cosAngle + u1 * (1 - cosAngle);
+  float rootOneMinusZSquared = sqrtf(1 - z * z);
+  float x = rootOneMinusZSquared * cosf(theta);
+  float y = rootOneMinusZSquared * sinf(theta);
+
+  glm::vec4 direction(x, y, z, 1.0f);
+
+  if (coneDirection != glm::vec3(0.0f, 0.0f, 1.0f) &&
+      coneDirection != glm::vec3(0.0f, 0.0f, -1.0f)) {
+    glm::vec3 rotateAxis =
+        glm::cross(coneDirection, glm::vec3(0.0f, 0.0f, 1.0f));
+    rotateAxis = glm::normalize(rotateAxis);
+    float rotateAngle =
+        glm::acos(glm::dot(coneDirection, glm::vec3(0.0f, 0.0f, 1.0f)));
+
+    glm::mat4 rotationMatrix =
+        glm::rotate(glm::mat4(1.0f), -rotateAngle, rotateAxis);
+    direction = rotationMatrix * direction;
+  } else if (coneDirection == glm::vec3(0.0f, 0.0f, -1.0f)) {
+    direction.z *= -1.0f;
+  }
+
+  return glm::vec3(direction);
+}
+
+void depthSortOrder(const float *depthKeys, std::uint32_t *order,
+                    std::size_t count) {
+  for (std::size_t i = 0; i < count; ++i)
+    order[i] = static_cast<std::uint32_t>(i);
+  std::sort(order, order + count, [depthKeys](std::uint32_t a, std::uint32_t b) {
+    return depthKeys[a] > depthKeys[b];
+  });
+}
@@ -0,0 +1,22 @@
+#ifndef PARTICLE_MATH_HPP
+#define PARTICLE_MATH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+// Stateless pieces of ParticleSystem, kept as free functions so the kernel
+// benchmarks time exactly the code the simulation runs.
+
+// Uniform direction on the sphere from two uniform samples in [0, 1).
+glm::vec3 unitVectorFromSamples(float u0, float u1);
+// Uniform direction within angle radians of coneDirection (unit length).
+glm::vec3 unitVectorWithinCone(const glm::vec3 &coneDirection, float angle,
+                               float u0, float u1);
+
+// Back-to-front order of count squared camera distances: order[0] is the
+// index of the farthest key.
+void depthSortOrder(const float *depthKeys, std::uint32_t *order,
+                    std::size_t count);
+
+#endif // PARTICLE_MATH_HPP
@@ -0,0 +1,488 @@
+#include "particle_system.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+
+#include "cpu_profiler.hpp"
+#include "particle_kernels.hpp"
+#include "particle_math.hpp"
+#include "util.hpp"
+
+namespace {
+
+EmitterParams basicParams(float pps, float averageSpeed, float gravityEffect,
+                          float averageLifeLength, float averageScale) {
+  EmitterParams params;
+  params.pps = pps;
+  params.averageSpeed = averageSpeed;
+  params.gravityEffect = gravityEffect;
+  params.averageLifeLength = averageLifeLength;
+  params.averageScale = averageScale;
+  return params;
+}
+
+// Spreads the emitter seed out (neighbouring seeds would otherwise start
+// their flicker streams nearly alike) and keeps xorshift's state nonzero.
+std::uint32_t kernelSeed(std::uint32_t seed) {
+  std::uint32_t state = (seed ^ 0x9e3779b9u) * 0x85ebca6bu;
+  state ^= state >> 13;
+  return state ? state : 1;
+}
+
+} // namespace
+
+ParticleSystem::ParticleSystem(float pps, float averageSpeed,
+                               float gravityEffect, float averageLifeLength,
+                               float averageScale)
+    : ParticleSystem(basicParams(pps, averageSpeed, gravityEffect,
+                                 averageLifeLength, averageScale),
+                     std::random_device{}()) {}
+
+ParticleSystem::ParticleSystem(const EmitterParams &params, std::uint32_t seed)
+    : params(params), randomEngine(seed), randomDist(0.0f, 1.0f),
+      kernelRandom(kernelSeed(seed)) {
+  publishedParams.publish(params);
+
+  // Room for the steady state of the initial rate, at most 1000 slots; a
+  // grid of small emitters then does not start out with mostly empty pools.
+  float steadyState = params.pps * params.averageLifeLength;
+  std::size_t slots = static_cast<std::size_t>(
+      std::ceil(std::clamp(steadyState, 1.0f, 1000.0f)));
+  if (params.storage == ParticleStorage::Compact) {
+    compactParticles.resize(slots);
+    particleBytes = slots * sizeof(CompactParticle);
+  } else {
+    particles.resize(slots);
+    particleBytes = slots * sizeof(Particle);
+  }
+}
+
+void ParticleSystem::update(float deltaTime, const glm::vec3 &cameraPosition) {
+  PROFILE_ZONE("ParticleSystem::update");
+  const ParticleKernels &kernels = particleKernels();
+
+  ParticleStorage storage = params.storage;
+  params = publishedParams.load();
+  if (params.storage != storage)
+    applyStorage(params.storage);
+
+  // Back-to-front: sort an index permutation on precomputed squared camera
+  // distances, then gather the particles into that order.
+  using Clock = std::chrono::steady_clock;
+  if (stepObserver)
+    stepObserver->beginPhase(StepPhase::Simulate);
+  Clock::time_point start = Clock::now();
+  Clock::time_point simulated;
+  if (params.storage == ParticleStorage::Compact) {
+    const std::size_t count = compactParticles.size();
+    {
+      PROFILE_ZONE("simulate");
+      kernels.updateCompact(compactParticles.data(), count, deltaTime,
+                            compactParams(), kernelRandom);
+    }
+    simulated = Clock::now();
+    switchPhase(StepPhase::Simulate, StepPhase::Sort);
+    PROFILE_ZONE("sort");
+    FrameVector<float> depthKeys(count);
+    kernels.depthKeysCompact(compactParticles.data(), count, cameraPosition.x,
+                             cameraPosition.y, cameraPosition.z,
+                             depthKeys.data());
+    applySortOrder(compactParticles, sortedCompactParticles,
+                   sortByDepth(depthKeys));
+  } else {
+    const std::size_t count = particles.size();
+    {
+      PROFILE_ZONE("simulate");
+      kernels.update(particles.data(), count, deltaTime, kernelRandom);
+    }
+    simulated = Clock::now();
+    switchPhase(StepPhase::Simulate, StepPhase::Sort);
+    PROFILE_ZONE("sort");
+    FrameVector<float> depthKeys(count);
+    kernels.depthKeys(particles.data(), count, cameraPosition.x,
+                      cameraPosition.y, cameraPosition.z, depthKeys.data());
+    applySortOrder(particles, sortedParticles, sortByDepth(depthKeys));
+  }
+  Clock::time_point sorted = Clock::now();
+  switchPhase(StepPhase::Sort, StepPhase::Emit);
+
+  emitParticles(params.position, deltaTime);
+
+  Clock::time_point emitted = Clock::now();
+  if (stepObserver)
+    stepObserver->endPhase(StepPhase::Emit);
+  stepTimings.simulate =
+      std::chrono::duration<double>(simulated - start).count();
+  stepTimings.sort = std::chrono::duration<double>(sorted - simulated).count();
+  stepTimings.emit = std::chrono::duration<double>(emitted - sorted).count();
+
+  particleBytes = params.storage == ParticleStorage::Compact
+                      ? compactParticles.size() * sizeof(CompactParticle)
+                      : particles.size() * sizeof(Particle);
+}
+
+void ParticleSystem::switchPhase(StepPhase ended, StepPhase started) {
+  if (!stepObserver)
+    return;
+  stepObserver->endPhase(ended);
+  stepObserver->beginPhase(started);
+}
+
+FrameVector<std::uint32_t>
+ParticleSystem::sortByDepth(const FrameVector<float> &depthKeys) {
+  FrameVector<std::uint32_t> order(depthKeys.size());
+  depthSortOrder(depthKeys.data(), order.data(), order.size());
+  return order;
+}
+
+template <typename T>
+void ParticleSystem::applySortOrder(std::vector<T> &items,
+                                    std::vector<T> &scratch,
+                                    const FrameVector<std::uint32_t> &order) {
+  scratch.resize(items.size());
+  for (std::size_t i = 0; i < items.size(); ++i)
+    scratch[i] = items[order[i]];
+  items.swap(scratch);
+}
+
+template <typename Emit>
+void ParticleSystem::forEachInstance(Emit &&emit) const {
+  if (params.storage == ParticleStorage::Compact) {
+    for (const CompactParticle &particle : compactParticles) {
+      if (!particle.isActive())
+        continue;
+
+      float lifeFactor = particle.getLifeFactor();
+      FlipbookFrame flipbook = flipbookFrame(lifeFactor, params.textureRows);
+
+      ParticleInstance instance;
+      instance.position = particle.getPosition();
+      instance.scale = particle.getScale(params.averageScale);
+      instance.rotation = particle.getRotation();
+      instance.blendFactor = flipbook.blendFactor;
+      instance.lifeFactor = lifeFactor;
+      instance.currentTextureIndex = flipbook.currentTextureIndex;
+      instance.nextTextureIndex = flipbook.nextTextureIndex;
+      emit(instance);
+    }
+    return;
+  }
+
+  for (const Particle &particle : particles) {
+    if (!particle.isActive())
+      continue;
+
+    ParticleInstance instance;
+    instance.position = particle.getPosition();
+    instance.scale = particle.getScale();
+    instance.rotation = particle.getRotation();
+    instance.blendFactor = particle.getBlendFactor();
+    instance.lifeFactor = particle.getLifeFactor();
+    instance.currentTextureIndex = particle.getCurrentTextureIndex();
+    instance.nextTextureIndex = particle.getNextTextureIndex();
+    emit(instance);
+  }
+}
+
+void ParticleSystem::writeFrame(ParticleFrame &frame) const {
+  PROFILE_ZONE("ParticleSystem::writeFrame");
+  frame.textureRows = params.textureRows;
+  frame.origin = params.position;
+  frame.instances.clear();
+  forEachInstance([&](const ParticleInstance &instance) {
+    frame.instances.push_back(instance);
+  });
+}
+
+std::size_t ParticleSystem::writeInstances(ParticleInstance *out) const {
+  std::size_t count = 0;
+  forEachInstance(
+      [&](const ParticleInstance &instance) { out[count++] = instance; });
+  return count;
+}
+
+std::size_t
+ParticleSystem::writePackedInstances(PackedParticleInstance *out) const {
+  std::size_t count = 0;
+  forEachInstance([&](const ParticleInstance &instance) {
+    out[count++] = packInstance(instance, params.position);
+  });
+  return count;
+}
+
+std::size_t ParticleSystem::getSlotCount() const {
+  return params.storage == ParticleStorage::Compact ? compactParticles.size()
+                                                    : particles.size();
+}
+
+glm::vec3 ParticleSystem::getEmitterPosition() const {
+  return params.position;
+}
+
+void ParticleSystem::emitParticles(const glm::vec3 &position, float deltaTime) {
+  PROFILE_ZONE("ParticleSystem::emitParticles");
+  // The fraction left over carries into the next frame, so emitters slower
+  // than the frame rate still spawn at their rate.
+  float particlesToCreate = params.pps * deltaTime + emitRemainder;
+  int count = static_cast<int>(std::floor(particlesToCreate));
+  emitRemainder = particlesToCreate - static_cast<float>(count);
+  if (count <= 0)
+    return;
+
+  FrameVector<SpawnRecord> batch;
+  batch.reserve(count);
+  for (int i = 0; i < count; ++i)
+    batch.push_back(generateSpawn());
+
+  spawnBatch(position, batch);
+}
+
+ParticleSystem::SpawnRecord ParticleSystem::generateSpawn() {
+  glm::vec3 velocity;
+
+  if (glm::length(params.direction) > 0.0f) {
+    velocity = generateRandomUnitVectorWithinCone(params.direction,
+                                                  params.directionDeviation);
+  } else {
+    velocity = generateRandomUnitVector();
+  }
+
+  velocity = glm::normalize(velocity);
+  float speed = generateValue(params.averageSpeed,
+                              params.speedError * params.averageSpeed);
+
+  SpawnRecord spawn;
+  spawn.velocity = velocity * speed;
+  spawn.scale = generateValue(params.averageScale,
+                              params.scaleError * params.averageScale);
+  spawn.lifeLength = generateValue(params.averageLifeLength,
+                                   params.lifeError * params.averageLifeLength);
+  spawn.rotation =
+      params.randomRotation ? randomDist(randomEngine) * 360.0f : 0.0f;
+  return spawn;
+}
+
+void ParticleSystem::spawnBatch(const glm::vec3 &position,
+                                const FrameVector<SpawnRecord> &batch) {
+  // Free slots are filled in order; the search resumes where the previous
+  // spawn of the batch left off instead of rescanning from the start.
+  std::size_t slot = 0;
+
+  if (params.storage == ParticleStorage::Compact) {
+    for (const SpawnRecord &spawn : batch) {
+      while (slot < compactParticles.size() &&
+             compactParticles[slot].isActive())
+        ++slot;
+      if (slot == compactParticles.size())
+        compactParticles.emplace_back();
+      compactParticles[slot].activate(position, spawn.velocity,
+                                      spawn.lifeLength, spawn.rotation,
+                                      spawn.scale, params.averageScale);
+    }
+    return;
+  }
+
+  float gravity = params.gravityEffect * util::GRAVITY;
+  for (const SpawnRecord &spawn : batch) {
+    while (slot < particles.size() && particles[slot].isActive())
+      ++slot;
+    if (slot == particles.size())
+      particles.emplace_back();
+    particles[slot].activate(position, spawn.velocity, gravity,
+                             spawn.lifeLength, spawn.rotation, spawn.scale,
+                             params.textureRows, params.turbulenceScale,
+                             params.turbulenceStrength);
+  }
+}
+
+float ParticleSystem::generateValue(float average, float errorMargin) {
+  float offset = (randomDist(randomEngine) - 0.5f) * 2.0f * errorMargin;
+  return average + offset;
+}
+
+glm::vec3 ParticleSystem::generateRandomUnitVector() {
+  float u0 = randomDist(randomEngine);
+  float u1 = randomDist(randomEngine);
+  return unitVectorFromSamples(u0, u1);
+}
+
+glm::vec3 ParticleSystem::generateRandomUnitVectorWithinCone(
+    const glm::vec3 &coneDirection, float angle) {
+  float u0 = randomDist(randomEngine);
+  float u1 = randomDist(randomEngine);
+  return unitVectorWithinCone(coneDirection, angle, u0, u1);
+}
+
+void ParticleSystem::applyStorage(ParticleStorage storage) {
+  std::size_t capacity = storage == ParticleStorage::Compact
+                             ? particles.size()
+                             : compactParticles.size();
+
+  particles.clear();
+  compactParticles.clear();
+  sortedParticles.clear();
+  sortedCompactParticles.clear();
+  if (storage == ParticleStorage::Compact) {
+    particles.shrink_to_fit();
+    sortedParticles.shrink_to_fit();
+    compactParticles.resize(capacity);
+  } else {
+    compactParticles.shrink_to_fit();
+    sortedCompactParticles.shrink_to_fit();
+    particles.resize(capacity);
+  }
+}
+
+CompactParticleParams ParticleSystem::compactParams() const {
+  CompactParticleParams compact;
+  compact.gravityEffect = params.gravityEffect * util::GRAVITY;
+  compact.turbulenceScale = params.turbulenceScale;
+  compact.turbulenceStrength = params.turbulenceStrength;
+  compact.averageScale = params.averageScale;
+  compact.textureRows = params.textureRows;
+  return compact;
+}
+
+EmitterParams ParticleSystem::getParams() const {
+  return publishedParams.load();
+}
+
+std::uint64_t ParticleSystem::getParamsVersion() const {
+  return publishedParams.version();
+}
+
+void ParticleSystem::setParams(const EmitterParams &params) {
+  publishedParams.publish(params);
+}
+
+// The single-field setters below are read-modify-write on the published
+// block, meant for setup code; concurrent editors should build a whole
+// EmitterParams and call setParams() once.
+
+void ParticleSystem::setDirection(const glm::vec3 &direction, float deviation) {
+  EmitterParams edit = getParams();
+  edit.direction = glm::normalize(direction);
+  edit.directionDeviation = deviation;
+  setParams(edit);
+}
+
+void ParticleSystem::randomizeRotation() {
+  EmitterParams edit = getParams();
+  edit.randomRotation = true;
+  setParams(edit);
+}
+
+void ParticleSystem::setStorage(ParticleStorage storage) {
+  EmitterParams edit = getParams();
+  edit.storage = storage;
+  setParams(edit);
+}
+
+ParticleStorage ParticleSystem::getStorage() const {
+  return getParams().storage;
+}
+
+std::size_t ParticleSystem::getParticleBytes() const { return particleBytes; }
+
+const ParticleSystem::StepTimings &ParticleSystem::getStepTimings() const {
+  return stepTimings;
+}
+
+void ParticleSystem::setStepObserver(StepObserver *observer) {
+  stepObserver = observer;
+}
+
+void ParticleSystem::setSpeedError(float error) {
+  EmitterParams edit = getParams();
+  edit.speedError = error;
+  setParams(edit);
+}
+
+void ParticleSystem::setLifeError(float error) {
+  EmitterParams edit = getParams();
+  edit.lifeError = error;
+  setParams(edit);
+}
+
+void ParticleSystem::setScaleError(float error) {
+  EmitterParams edit = getParams();
+  edit.scaleError = error;
+  setParams(edit);
+}
+
+float ParticleSystem::getPPS() const { return getParams().pps; }
+float ParticleSystem::getAverageSpeed() const {
+  return getParams().averageSpeed;
+}
+float ParticleSystem::getGravityEffect() const {
+  return getParams().gravityEffect;
+}
+float ParticleSystem::getAverageLifeLength() const {
+  return getParams().averageLifeLength;
+}
+float ParticleSystem::getAverageScale() const {
+  return getParams().averageScale;
+}
+float ParticleSystem::getSpeedError() const { return getParams().speedError; }
+float ParticleSystem::getLifeError() const { return getParams().lifeError; }
+float ParticleSystem::getScaleError() const { return getParams().scaleError; }
+float ParticleSystem::getTurbulenceStrength() const {
+  return getParams().turbulenceStrength;
+}
+float ParticleSystem::getTurbulenceScale() const {
+  return getParams().turbulenceScale;
+}
+bool ParticleSystem::isRandomRotation() const {
+  return getParams().randomRotation;
+}
+glm::vec3 ParticleSystem::getDirection() const { return getParams().direction; }
+float ParticleSystem::getDirectionDeviation() const {
+  return getParams().directionDeviation;
+}
+
+void ParticleSystem::setPPS(float pps) {
+  EmitterParams edit = getParams();
+  edit.pps = pps;
+  setParams(edit);
+}
+void ParticleSystem::setAverageSpeed(float speed) {
+  EmitterParams edit = getParams();
+  edit.averageSpeed = speed;
+  setParams(edit);
+}
+void ParticleSystem::setGravityEffect(float gravityEffect) {
+  EmitterParams edit = getParams();
+  edit.gravityEffect = gravityEffect;
+  setParams(edit);
+}
+void ParticleSystem::setAverageLifeLength(float lifeLength) {
+  EmitterParams edit = getParams();
+  edit.averageLifeLength = lifeLength;
+  setParams(edit);
+}
+void ParticleSystem::setTextureRows(unsigned int rows) {
+  EmitterParams edit = getParams();
+  edit.textureRows = rows;
+  setParams(edit);
+}
+void ParticleSystem::setAverageScale(float scale) {
+  EmitterParams edit = getParams();
+  edit.averageScale = scale;
+  setParams(edit);
+}
+void ParticleSystem::setTurbulenceStrength(float turbulenceStrength) {
+  EmitterParams edit = getParams();
+  edit.turbulenceStrength = turbulenceStrength;
+  setParams(edit);
+}
+void ParticleSystem::setTurbulenceScale(float turbulenceScale) {
+  EmitterParams edit = getParams();
+  edit.turbulenceScale = turbulenceScale;
+  setParams(edit);
+}
+void ParticleSystem::disableRandomRotation() {
+  EmitterParams edit = getParams();
+  edit.randomRotation = false;
+  setParams(edit);
+}
@@ -0,0 +1,190 @@
+#ifndef PARTICLE_SYSTEM_HPP
+#define PARTICLE_SYSTEM_HPP
+
+#include "compact_particle.hpp"
+#include "frame_arena.hpp"
+#include "particle.hpp"
+#include "particle_frame.hpp"
+#include "seqlock.hpp"
+#include <atomic>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <memory>
+#include <random>
+#include <vector>
+
+// Full keeps one 72-byte Particle per slot. Compact keeps one 24-byte
+// CompactParticle, trading precision of velocity, age, rotation and scale for
+// a third of the memory traffic on large systems.
+enum class ParticleStorage { Full, Compact };
+
+// Tunables of one emitter, published as a whole. update() takes one snapshot
+// at the start of a step and runs the whole step with it, so the GUI or any
+// other tool can publish new blocks from another thread at any time.
+struct EmitterParams {
+  float pps;
+  float averageSpeed;
+  float gravityEffect;
+  float averageLifeLength;
+  float averageScale;
+  float turbulenceScale = 1.0f;
+  float turbulenceStrength = 0.5f;
+
+  // Relative to the matching average.
+  float speedError = 0.0f;
+  float lifeError = 0.0f;
+  float scaleError = 0.0f;
+  bool randomRotation = false;
+  glm::vec3 direction = glm::vec3(0.0f);
+  float directionDeviation = 0.0f;
+
+  unsigned int textureRows = 1;
+  ParticleStorage storage = ParticleStorage::Full;
+  // Where update() spawns; packed instances are stored relative to it.
+  glm::vec3 position = glm::vec3(0.0f, 0.1f, 0.0f);
+};
+
+// Emitter simulation: spawning, the per-ISA update kernels and the depth
+// sort. Plain CPU code with no GL dependency; ParticleRenderer draws what
+// writeFrame() or writeInstances() produce.
+class ParticleSystem {
+public:
+  // Wall time of the phases of the last update(), in seconds.
+  struct StepTimings {
+    double simulate = 0.0;
+    double sort = 0.0;
+    double emit = 0.0;
+  };
+
+  enum class StepPhase { Simulate, Sort, Emit };
+
+  // Told where the phases of update() start and end, on the updating
+  // thread, for instrumentation such as hardware counters.
+  class StepObserver {
+  public:
+    virtual ~StepObserver() = default;
+    virtual void beginPhase(StepPhase phase) = 0;
+    virtual void endPhase(StepPhase phase) = 0;
+  };
+
+  ParticleSystem(float pps, float averageSpeed, float gravityEffect,
+                 float averageLifeLength, float averageScale);
+  // Same random sequence for the same seed and parameters, spawning and the
+  // kernels' flicker alike, so generated scenes replay exactly (with one
+  // standard library).
+  ParticleSystem(const EmitterParams &params, std::uint32_t seed);
+
+  void update(float deltaTime, const glm::vec3 &cameraPosition);
+
+  // Copies the live particles of the last update() into frame, back to
+  // front. Only touches simulation state, so it belongs with update().
+  void writeFrame(ParticleFrame &frame) const;
+  // Same, straight into out, which must have room for getSlotCount()
+  // instances. Returns how many were written.
+  std::size_t writeInstances(ParticleInstance *out) const;
+  // Same, packed relative to getEmitterPosition().
+  std::size_t writePackedInstances(PackedParticleInstance *out) const;
+  // Upper bound on the live particles of the last update().
+  std::size_t getSlotCount() const;
+  // Where the last update() spawned.
+  glm::vec3 getEmitterPosition() const;
+
+  void setDirection(const glm::vec3 &direction, float deviation);
+  void randomizeRotation();
+  void setSpeedError(float error);
+  void setLifeError(float error);
+  void setScaleError(float error);
+
+  void emitParticles(const glm::vec3 &position, float deltaTime);
+
+  // Latest published parameter block, and a counter that changes with each
+  // publish. Safe from any thread.
+  EmitterParams getParams() const;
+  std::uint64_t getParamsVersion() const;
+  // Publishes a complete parameter block; picked up by the next update().
+  void setParams(const EmitterParams &params);
+
+  // Switching drops the live particles, the effect restarts empty.
+  void setStorage(ParticleStorage storage);
+  ParticleStorage getStorage() const;
+  // Bytes held by the particle slots as of the last update().
+  std::size_t getParticleBytes() const;
+  const StepTimings &getStepTimings() const;
+  // Not owned; nullptr (the default) disables the calls.
+  void setStepObserver(StepObserver *observer);
+
+private:
+  template <typename Emit> void forEachInstance(Emit &&emit) const;
+  void applyStorage(ParticleStorage storage);
+  void switchPhase(StepPhase ended, StepPhase started);
+  // One particle to be spawned, generated in batches per frame.
+  struct SpawnRecord {
+    glm::vec3 velocity;
+    float lifeLength;
+    float rotation;
+    float scale;
+  };
+
+  SpawnRecord generateSpawn();
+  void spawnBatch(const glm::vec3 &position,
+                  const FrameVector<SpawnRecord> &batch);
+  FrameVector<std::uint32_t> sortByDepth(const FrameVector<float> &depthKeys);
+  template <typename T>
+  void applySortOrder(std::vector<T> &items, std::vector<T> &scratch,
+                      const FrameVector<std::uint32_t> &order);
+  CompactParticleParams compactParams() const;
+
+  float generateValue(float average, float errorMargin);
+  glm::vec3 generateRandomUnitVector();
+  glm::vec3 generateRandomUnitVectorWithinCone(const glm::vec3 &coneDirection,
+                                               float angle);
+
+  std::vector<Particle> particles;
+  std::vector<CompactParticle> compactParticles;
+
+  // Gather targets of the depth sort, swapped with the live vectors each
+  // update so neither is reallocated.
+  std::vector<Particle> sortedParticles;
+  std::vector<CompactParticle> sortedCompactParticles;
+
+  // Snapshot of publishedParams the current step runs with.
+  EmitterParams params;
+  SeqLock<EmitterParams> publishedParams;
+  std::atomic<std::size_t> particleBytes{0};
+  StepTimings stepTimings;
+  StepObserver *stepObserver = nullptr;
+  // Fraction of a particle owed by emitParticles().
+  float emitRemainder = 0.0f;
+
+  std::mt19937 randomEngine;
+  std::uniform_real_distribution<float> randomDist;
+  // xorshift32 state of the update kernels' flicker and dither.
+  std::uint32_t kernelRandom;
+
+public:
+  float getPPS() const;
+  float getAverageSpeed() const;
+  float getGravityEffect() const;
+  float getAverageLifeLength() const;
+  float getAverageScale() const;
+  float getSpeedError() const;
+  float getLifeError() const;
+  float getScaleError() const;
+  bool isRandomRotation() const;
+  glm::vec3 getDirection() const;
+  float getDirectionDeviation() const;
+  float getTurbulenceStrength() const;
+  float getTurbulenceScale() const;
+
+  void setPPS(float pps);
+  void setAverageSpeed(float speed);
+  void setGravityEffect(float gravityEffect);
+  void setAverageLifeLength(float lifeLength);
+  void setAverageScale(float scale);
+  void setTurbulenceStrength(float turbulenceStrength);
+  void setTurbulenceScale(float turbulenceScale);
+  void disableRandomRotation();
+  void setTextureRows(unsigned int rows);
+};
+
+#endif // PARTICLE_SYSTEM_HPP
@@ -0,0 +1,84 @@
+#ifndef SEQLOCK_HPP
+#define SEQLOCK_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Publishes whole values of a trivially copyable T to any number of readers.
+// Readers never block and never see a value torn between two publishes, they
+// retry the copy if a publish overlapped it. Publishers only wait for each
+// other, never for readers.
+//
+// The payload is stored as relaxed atomic words so the racing copy is well
+// defined (see Boehm, "Can Seqlocks Get Along With Programming Language
+// Memory Models?").
+template <typename T> class SeqLock {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "SeqLock payload must be trivially copyable");
+
+public:
+  SeqLock() = default;
+  explicit SeqLock(const T &initial) { store(initial); }
+
+  SeqLock(const SeqLock &) = delete;
+  SeqLock &operator=(const SeqLock &) = delete;
+
+  void publish(const T &value) {
+    while (writing.test_and_set(std::memory_order_acquire)) {
+    }
+    store(value);
+    writing.clear(std::memory_order_release);
+  }
+
+  // Returns a consistent copy of the latest published value. version, if
+  // given, receives a number that changes with every publish.
+  T load(std::uint64_t *version = nullptr) const {
+    Words words;
+    std::uint64_t before, after;
+    do {
+      before = sequence.load(std::memory_order_acquire);
+      if (before & 1)
+        continue;
+      for (std::size_t i = 0; i < wordCount; ++i)
+        words[i] = data[i].load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      after = sequence.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+
+    if (version)
+      *version = before >> 1;
+
+    T value;
+    std::memcpy(&value, words, sizeof(T));
+    return value;
+  }
+
+  std::uint64_t version() const {
+    return sequence.load(std::memory_order_acquire) >> 1;
+  }
+
+private:
+  static constexpr std::size_t wordCount =
+      (sizeof(T) + sizeof(std::uint32_t) - 1) / sizeof(std::uint32_t);
+  using Words = std::uint32_t[wordCount];
+
+  void store(const T &value) {
+    Words words = {};
+    std::memcpy(words, &value, sizeof(T));
+
+    std::uint64_t seq = sequence.load(std::memory_order_relaxed);
+    sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (std::size_t i = 0; i < wordCount; ++i)
+      data[i].store(words[i], std::memory_order_relaxed);
+    sequence.store(seq + 2, std::memory_order_release);
+  }
+
+  std::atomic<std::uint64_t> sequence{0};
+  std::atomic<std::uint32_t> data[wordCount] = {};
+  std::atomic_flag writing = ATOMIC_FLAG_INIT;
+};
+
+#endif // SEQLOCK_HPP
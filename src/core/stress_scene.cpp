@@ -0,0 +1,379 @@
+#include "stress_scene.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+namespace {
+
+// From the raw engine output, which the standard fixes, unlike the
+// distributions; scenes come out the same with every standard library.
+float uniform(std::mt19937 &engine) {
+  return static_cast<float>(engine() >> 8) * (1.0f / 16777216.0f);
+}
+
+float spread(float value, float relative, float u) {
+  return std::max(0.0f, value * (1.0f + relative * (u * 2.0f - 1.0f)));
+}
+
+bool parseFloat(const std::string &text, float &value) {
+  char *end = nullptr;
+  value = std::strtof(text.c_str(), &end);
+  return end && end != text.c_str() && *end == '\0';
+}
+
+bool parseInt(const std::string &text, int &value) {
+  char *end = nullptr;
+  long parsed = std::strtol(text.c_str(), &end, 10);
+  value = static_cast<int>(parsed);
+  return end && end != text.c_str() && *end == '\0';
+}
+
+bool parseSeed(const std::string &text, std::uint32_t &value) {
+  char *end = nullptr;
+  unsigned long parsed = std::strtoul(text.c_str(), &end, 0);
+  value = static_cast<std::uint32_t>(parsed);
+  return end && end != text.c_str() && *end == '\0';
+}
+
+} // namespace
+
+EmitterParams campfireEmitter() {
+  EmitterParams params;
+  params.pps = 500.0f;
+  params.averageSpeed = 5.0f;
+  params.gravityEffect = -1.5f;
+  params.averageLifeLength = 2.0f;
+  params.averageScale = 2.0f;
+  params.direction = glm::vec3(0.0f, 1.0f, 0.0f);
+  params.directionDeviation = glm::radians(15.0f);
+  params.speedError = 0.2f;
+  params.lifeError = 0.2f;
+  params.scaleError = 0.5f;
+  params.randomRotation = true;
+  params.textureRows = 8;
+  return params;
+}
+
+StressScene generateStressScene(const StressSceneConfig &config) {
+  StressScene scene;
+  scene.camera = config.camera;
+  scene.cameraDistance = config.cameraDistance;
+  scene.cameraHeight = config.cameraHeight;
+  scene.cameraPeriod = config.cameraPeriod;
+
+  const int count = config.emitters > 0 ? config.emitters : 1;
+  const glm::vec3 centre = config.emitter.position;
+  const int columns = static_cast<int>(std::ceil(std::sqrt(count)));
+  const int rows = (count + columns - 1) / columns;
+  const float side = config.spacing * std::sqrt(static_cast<float>(count));
+
+  std::mt19937 engine(config.seed);
+  scene.emitters.reserve(count);
+  for (int i = 0; i < count; ++i) {
+    // Always the same draws per emitter, so changing the layout or a spread
+    // leaves everything else in the scene where it was.
+    StressScene::Emitter emitter;
+    emitter.seed = static_cast<std::uint32_t>(engine());
+    float x = uniform(engine);
+    float z = uniform(engine);
+    float ppsSample = uniform(engine);
+    float lifeSample = uniform(engine);
+
+    emitter.params = config.emitter;
+    emitter.params.pps =
+        spread(config.emitter.pps, config.ppsSpread, ppsSample);
+    emitter.params.averageLifeLength =
+        spread(config.emitter.averageLifeLength, config.lifeSpread, lifeSample);
+
+    glm::vec3 offset(0.0f);
+    if (config.layout == StressLayout::Grid) {
+      offset.x = (i % columns - (columns - 1) * 0.5f) * config.spacing;
+      offset.z = (i / columns - (rows - 1) * 0.5f) * config.spacing;
+    } else if (config.layout == StressLayout::Scatter) {
+      offset.x = (x - 0.5f) * side;
+      offset.z = (z - 0.5f) * side;
+    }
+    emitter.params.position = centre + offset;
+
+    if (i == 0) {
+      scene.boundsMin = scene.boundsMax = emitter.params.position;
+    } else {
+      scene.boundsMin = glm::min(scene.boundsMin, emitter.params.position);
+      scene.boundsMax = glm::max(scene.boundsMax, emitter.params.position);
+    }
+    scene.emitters.push_back(emitter);
+  }
+  return scene;
+}
+
+glm::vec3 StressScene::cameraPosition(float time) const {
+  const float twoPi = 6.28318530718f;
+  glm::vec3 centre = (boundsMin + boundsMax) * 0.5f;
+  glm::vec3 half = (boundsMax - boundsMin) * 0.5f;
+  float radius = glm::length(glm::vec2(half.x, half.z));
+  float phase = cameraPeriod > 0.0f ? time / cameraPeriod : 0.0f;
+
+  switch (camera) {
+  case CameraPath::Orbit: {
+    float distance = radius + cameraDistance;
+    return glm::vec3(centre.x + distance * std::sin(phase * twoPi),
+                     cameraHeight,
+                     centre.z + distance * std::cos(phase * twoPi));
+  }
+  case CameraPath::Flythrough: {
+    // Back and forth along z, straight through the emitters.
+    float t = phase - std::floor(phase);
+    float reach = half.z + cameraDistance;
+    float z = reach * (t < 0.5f ? 1.0f - 4.0f * t : 4.0f * t - 3.0f);
+    return glm::vec3(centre.x, cameraHeight, centre.z + z);
+  }
+  case CameraPath::Inside:
+    return glm::vec3(centre.x, cameraHeight, centre.z);
+  case CameraPath::Grazing: {
+    glm::vec2 diagonal = radius > 0.0f ? glm::vec2(half.x, half.z) / radius
+                                       : glm::vec2(0.70710678f);
+    float distance = radius + cameraDistance;
+    return glm::vec3(centre.x + diagonal.x * distance, cameraHeight,
+                     centre.z + diagonal.y * distance);
+  }
+  case CameraPath::Static:
+  default:
+    return glm::vec3(centre.x, cameraHeight,
+                     centre.z + half.z + cameraDistance);
+  }
+}
+
+glm::vec3 StressScene::cameraTarget(float time) const {
+  glm::vec3 position = cameraPosition(time);
+  if (camera == CameraPath::Inside)
+    return position + glm::vec3(0.0f, 0.0f, -1.0f);
+  if (camera == CameraPath::Flythrough) {
+    float phase = cameraPeriod > 0.0f ? time / cameraPeriod : 0.0f;
+    bool outbound = phase - std::floor(phase) < 0.5f;
+    return position + glm::vec3(0.0f, 0.0f, outbound ? -1.0f : 1.0f);
+  }
+  return (boundsMin + boundsMax) * 0.5f;
+}
+
+double StressScene::expectedParticles() const {
+  double total = 0.0;
+  for (const Emitter &emitter : emitters)
+    total += static_cast<double>(emitter.params.pps) *
+             emitter.params.averageLifeLength;
+  return total;
+}
+
+std::vector<std::unique_ptr<ParticleSystem>>
+StressScene::createEmitters() const {
+  std::vector<std::unique_ptr<ParticleSystem>> systems;
+  systems.reserve(emitters.size());
+  for (const Emitter &emitter : emitters)
+    systems.push_back(
+        std::make_unique<ParticleSystem>(emitter.params, emitter.seed));
+  return systems;
+}
+
+bool applyStressPreset(const std::string &name, StressSceneConfig &config) {
+  StressSceneConfig preset;
+  preset.seed = config.seed;
+  EmitterParams &emitter = preset.emitter;
+  if (name == "campfire") {
+    // The default scene of the app.
+  } else if (name == "torches") {
+    // Ten thousand small systems: per-emitter simulation and stream mapping
+    // overhead. They batch into one draw on the attribute path; only the
+    // pulled path still draws each on its own.
+    preset.layout = StressLayout::Grid;
+    preset.emitters = 10000;
+    preset.spacing = 3.0f;
+    emitter.pps = 20.0f;
+    emitter.averageLifeLength = 1.5f;
+    emitter.averageSpeed = 2.0f;
+    emitter.averageScale = 1.0f;
+    preset.ppsSpread = 0.25f;
+    preset.lifeSpread = 0.2f;
+    preset.cameraDistance = 20.0f;
+    preset.cameraHeight = 25.0f;
+    preset.cameraPeriod = 30.0f;
+  } else if (name == "inferno") {
+    // One system of about 2M particles, seen from inside.
+    emitter.pps = 200000.0f;
+    emitter.averageLifeLength = 10.0f;
+    preset.camera = CameraPath::Inside;
+    preset.cameraHeight = 3.0f;
+  } else if (name == "scatter") {
+    // Randomly placed emitters of very different rates, flown through.
+    preset.layout = StressLayout::Scatter;
+    preset.emitters = 1000;
+    preset.spacing = 4.0f;
+    emitter.pps = 200.0f;
+    preset.ppsSpread = 0.9f;
+    preset.lifeSpread = 0.5f;
+    preset.camera = CameraPath::Flythrough;
+    preset.cameraDistance = 10.0f;
+    preset.cameraHeight = 2.0f;
+    preset.cameraPeriod = 20.0f;
+  } else if (name == "embers") {
+    // Slow, long lived particles: large, fragmented pools.
+    preset.layout = StressLayout::Grid;
+    preset.emitters = 100;
+    preset.spacing = 5.0f;
+    emitter.pps = 100.0f;
+    emitter.averageLifeLength = 30.0f;
+    emitter.averageSpeed = 1.0f;
+    emitter.gravityEffect = -0.05f;
+    emitter.turbulenceStrength = 1.0f;
+    preset.lifeSpread = 0.5f;
+    preset.cameraHeight = 10.0f;
+  } else if (name == "wall") {
+    // A dense grid seen edge on, everything overlapping on screen.
+    preset.layout = StressLayout::Grid;
+    preset.emitters = 400;
+    preset.spacing = 1.0f;
+    emitter.pps = 250.0f;
+    preset.camera = CameraPath::Grazing;
+    preset.cameraDistance = 5.0f;
+    preset.cameraHeight = 0.5f;
+  } else {
+    return false;
+  }
+  config = preset;
+  return true;
+}
+
+bool setStressSceneValue(StressSceneConfig &config, const std::string &key,
+                         const std::string &value) {
+  EmitterParams &emitter = config.emitter;
+  bool valid = true;
+  if (key == "preset")
+    valid = applyStressPreset(value, config);
+  else if (key == "seed")
+    valid = parseSeed(value, config.seed);
+  else if (key == "layout") {
+    if (value == "stacked")
+      config.layout = StressLayout::Stacked;
+    else if (value == "grid")
+      config.layout = StressLayout::Grid;
+    else if (value == "scatter")
+      config.layout = StressLayout::Scatter;
+    else
+      valid = false;
+  } else if (key == "emitters")
+    valid = parseInt(value, config.emitters) && config.emitters > 0;
+  else if (key == "spacing")
+    valid = parseFloat(value, config.spacing);
+  else if (key == "pps")
+    valid = parseFloat(value, emitter.pps);
+  else if (key == "pps-spread")
+    valid = parseFloat(value, config.ppsSpread);
+  else if (key == "lifetime")
+    valid = parseFloat(value, emitter.averageLifeLength);
+  else if (key == "life-spread")
+    valid = parseFloat(value, config.lifeSpread);
+  else if (key == "life-error")
+    valid = parseFloat(value, emitter.lifeError);
+  else if (key == "speed")
+    valid = parseFloat(value, emitter.averageSpeed);
+  else if (key == "gravity")
+    valid = parseFloat(value, emitter.gravityEffect);
+  else if (key == "scale")
+    valid = parseFloat(value, emitter.averageScale);
+  else if (key == "turbulence")
+    valid = parseFloat(value, emitter.turbulenceStrength);
+  else if (key == "turbulence-scale")
+    valid = parseFloat(value, emitter.turbulenceScale);
+  else if (key == "storage") {
+    valid = value == "full" || value == "compact";
+    emitter.storage = value == "compact" ? ParticleStorage::Compact
+                                         : ParticleStorage::Full;
+  } else if (key == "camera") {
+    if (value == "static")
+      config.camera = CameraPath::Static;
+    else if (value == "orbit")
+      config.camera = CameraPath::Orbit;
+    else if (value == "flythrough")
+      config.camera = CameraPath::Flythrough;
+    else if (value == "inside")
+      config.camera = CameraPath::Inside;
+    else if (value == "grazing")
+      config.camera = CameraPath::Grazing;
+    else
+      valid = false;
+  } else if (key == "camera-distance")
+    valid = parseFloat(value, config.cameraDistance);
+  else if (key == "camera-height")
+    valid = parseFloat(value, config.cameraHeight);
+  else if (key == "camera-period")
+    valid = parseFloat(value, config.cameraPeriod);
+  else {
+    std::cerr << "Unknown scene key: " << key << std::endl;
+    return false;
+  }
+
+  if (!valid)
+    std::cerr << "Bad value for " << key << ": " << value << std::endl;
+  return valid;
+}
+
+const char *stressSceneKeysHelp() {
+  return "  preset <name>            start from a preset, see below\n"
+         "  seed <n>                 placement, spreads, particle randomness\n"
+         "  layout stacked|grid|scatter\n"
+         "  emitters <n>             independent particle systems\n"
+         "  spacing <n>              grid pitch / scatter density\n"
+         "  pps <n>                  particles per second per emitter\n"
+         "  pps-spread <f>           per-emitter pps spread, relative\n"
+         "  lifetime <s>             average particle life\n"
+         "  life-spread <f>          per-emitter lifetime spread, relative\n"
+         "  life-error <f>           per-particle life spread, relative\n"
+         "  speed <n>                average speed\n"
+         "  gravity <n>              gravity effect\n"
+         "  scale <n>                average scale\n"
+         "  turbulence <n>           turbulence strength\n"
+         "  turbulence-scale <n>     turbulence frequency\n"
+         "  storage full|compact     particle layout\n"
+         "  camera static|orbit|flythrough|inside|grazing\n"
+         "  camera-distance <n>      distance outside the scene bounds\n"
+         "  camera-height <n>\n"
+         "  camera-period <s>        seconds per orbit or pass\n";
+}
+
+const char *stressPresetsHelp() {
+  return "  campfire                 one emitter, the app's default\n"
+         "  torches                  10000 small emitters on a grid\n"
+         "  inferno                  one emitter, about 2M particles\n"
+         "  scatter                  1000 random emitters, flythrough\n"
+         "  embers                   100 emitters, 30 s lifetimes\n"
+         "  wall                     400 emitters seen edge on\n";
+}
+
+const char *stressLayoutName(StressLayout layout) {
+  switch (layout) {
+  case StressLayout::Grid:
+    return "grid";
+  case StressLayout::Scatter:
+    return "scatter";
+  case StressLayout::Stacked:
+  default:
+    return "stacked";
+  }
+}
+
+const char *cameraPathName(CameraPath path) {
+  switch (path) {
+  case CameraPath::Orbit:
+    return "orbit";
+  case CameraPath::Flythrough:
+    return "flythrough";
+  case CameraPath::Inside:
+    return "inside";
+  case CameraPath::Grazing:
+    return "grazing";
+  case CameraPath::Static:
+  default:
+    return "static";
+  }
+}
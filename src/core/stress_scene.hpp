@@ -0,0 +1,95 @@
+#ifndef STRESS_SCENE_HPP
+#define STRESS_SCENE_HPP
+
+#include "particle_system.hpp"
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Synthetic scenes for scaling tests, shared by the app (--stress) and
+// particle_bench. A StressSceneConfig plus its seed always generates the
+// same emitters and camera path, so a scaling curve can be rerun point by
+// point. Each emitter's seed drives everything random in its particles,
+// spawning as well as the kernels' flicker and dither, so stepping a scene
+// with the same time steps gives the same frames on any thread. The app
+// steps by wall-clock frame time; only its layout and seeds match the bench.
+
+// Stacked puts every emitter at the origin, Grid on a square grid spacing
+// apart, Scatter uniformly over a square of the same area as the grid.
+enum class StressLayout { Stacked, Grid, Scatter };
+
+// The camera feeds the depth sort and, in the app, the view. Static, Orbit
+// and Flythrough keep cameraDistance outside the scene bounds (Flythrough
+// passes straight through them, so the sort order changes every frame).
+// Inside sits in the middle of the scene, the worst case for overdraw;
+// Grazing looks along the diagonal at cameraHeight, so every emitter is
+// stacked behind the others on screen.
+enum class CameraPath { Static, Orbit, Flythrough, Inside, Grazing };
+
+// The emitter the app shows by default: 500 pps in a 15 degree cone, a
+// flipbook of 8 rows.
+EmitterParams campfireEmitter();
+
+struct StressSceneConfig {
+  std::uint32_t seed = 1;
+  StressLayout layout = StressLayout::Stacked;
+  int emitters = 1;
+  float spacing = 2.0f;
+
+  // Shape of every emitter; position is set by the layout.
+  EmitterParams emitter = campfireEmitter();
+  // Per-emitter random spread of pps and lifetime, relative.
+  float ppsSpread = 0.0f;
+  float lifeSpread = 0.0f;
+
+  CameraPath camera = CameraPath::Orbit;
+  float cameraDistance = 20.0f;
+  float cameraHeight = 1.0f;
+  // Seconds per orbit, or per pass through the scene.
+  float cameraPeriod = 10.0f;
+};
+
+struct StressScene {
+  struct Emitter {
+    EmitterParams params;
+    std::uint32_t seed;
+  };
+
+  std::vector<Emitter> emitters;
+  // Of the emitter positions.
+  glm::vec3 boundsMin = glm::vec3(0.0f);
+  glm::vec3 boundsMax = glm::vec3(0.0f);
+
+  CameraPath camera = CameraPath::Orbit;
+  float cameraDistance = 20.0f;
+  float cameraHeight = 1.0f;
+  float cameraPeriod = 10.0f;
+
+  glm::vec3 cameraPosition(float time) const;
+  // A point the camera looks at, for paths that have no natural target.
+  glm::vec3 cameraTarget(float time) const;
+  // Live particles once every emitter has reached its steady state.
+  double expectedParticles() const;
+  std::vector<std::unique_ptr<ParticleSystem>> createEmitters() const;
+};
+
+StressScene generateStressScene(const StressSceneConfig &config);
+
+// Replaces config with a named preset, keeping its seed. False for an
+// unknown name.
+bool applyStressPreset(const std::string &name, StressSceneConfig &config);
+
+// Sets one key of the text form shared by scenario files, particle_bench
+// --key value and the app's --stress-key value; "preset" applies a preset.
+// False with a message on stderr for an unknown key or a bad value.
+bool setStressSceneValue(StressSceneConfig &config, const std::string &key,
+                         const std::string &value);
+const char *stressSceneKeysHelp();
+const char *stressPresetsHelp();
+const char *stressLayoutName(StressLayout layout);
+const char *cameraPathName(CameraPath path);
+
+#endif // STRESS_SCENE_HPP
@@ -0,0 +1,3 @@
+namespace util {
+  inline constexpr float GRAVITY = -9.81f;
+}
@@ -0,0 +1,35 @@
+#include "disk_cache.hpp"
+
+#include <filesystem>
+
+namespace diskCache {
+
+std::uint64_t hash(const void *data, std::size_t size, std::uint64_t seed) {
+  const unsigned char *bytes = static_cast<const unsigned char *>(data);
+  std::uint64_t value = seed;
+  for (std::size_t i = 0; i < size; ++i) {
+    value ^= bytes[i];
+    value *= 1099511628211ull;
+  }
+  return value;
+}
+
+std::uint64_t hash(const std::string &text, std::uint64_t seed) {
+  return hash(text.c_str(), text.size() + 1, seed);
+}
+
+bool writeAtomically(const std::string &path,
+                     const std::function<bool(const std::string &)> &write) {
+  std::string temporary = path + ".tmp";
+  std::error_code error;
+  if (write(temporary))
+    std::filesystem::rename(temporary, path, error);
+  else
+    error = std::make_error_code(std::errc::io_error);
+  if (!error)
+    return true;
+  std::filesystem::remove(temporary, error);
+  return false;
+}
+
+} // namespace diskCache
@@ -0,0 +1,36 @@
+#ifndef DISK_CACHE_HPP
+#define DISK_CACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <type_traits>
+
+// Pieces shared by the on-disk caches (programs, textures): the key hash
+// and crash-safe entry writes. Safe to call from any thread.
+namespace diskCache {
+
+const std::uint64_t hashSeed = 14695981039346656037ull;
+
+// 64-bit FNV-1a, chained through seed.
+std::uint64_t hash(const void *data, std::size_t size,
+                   std::uint64_t seed = hashSeed);
+// Includes the terminator so ("ab", "c") and ("a", "bc") differ.
+std::uint64_t hash(const std::string &text, std::uint64_t seed = hashSeed);
+
+template <typename T>
+std::uint64_t hashValue(const T &value, std::uint64_t seed = hashSeed) {
+  static_assert(std::is_arithmetic<T>::value, "hash the bytes explicitly");
+  return hash(&value, sizeof(value), seed);
+}
+
+// Calls write with a temporary name next to path, then renames it over path,
+// so a crash never leaves a torn entry under the real name. False, with the
+// temporary removed, when write or the rename fails.
+bool writeAtomically(const std::string &path,
+                     const std::function<bool(const std::string &)> &write);
+
+} // namespace diskCache
+
+#endif // DISK_CACHE_HPP
@@ -0,0 +1,33 @@
+#include "frame_uniforms.hpp"
+
+#include <cstring>
+
+namespace {
+
+std::size_t uniformOffsetAlignment() {
+  GLint alignment = 0;
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+  return alignment > 0 ? static_cast<std::size_t>(alignment) : 256;
+}
+
+} // namespace
+
+FrameUniformBuffer::FrameUniformBuffer()
+    : stream(GL_UNIFORM_BUFFER, sizeof(FrameUniforms),
+             uniformOffsetAlignment()) {}
+
+void FrameUniformBuffer::update(const FrameUniforms &data) {
+  // The stream's frame stays open until the next update(), so its fence
+  // comes after every draw of this frame.
+  if (pending)
+    stream.endFrame();
+  stream.beginFrame();
+  pending = true;
+
+  void *region = stream.map(sizeof(FrameUniforms));
+  std::memcpy(region, &data, sizeof(FrameUniforms));
+  stream.unmap(sizeof(FrameUniforms));
+  glBindBufferRange(GL_UNIFORM_BUFFER, binding, stream.getBuffer(),
+                    static_cast<GLintptr>(stream.getOffset()),
+                    sizeof(FrameUniforms));
+}
@@ -0,0 +1,33 @@
+#ifndef FRAME_UNIFORMS_HPP
+#define FRAME_UNIFORMS_HPP
+
+#include "stream_buffer.hpp"
+#include <glm/glm.hpp>
+
+// Per-frame data shared by every program through the std140 FrameData block
+// at binding FrameUniformBuffer::binding, see the shaders in resources/.
+struct FrameUniforms {
+  glm::mat4 view;
+  glm::mat4 projection;
+  glm::vec4 cameraPosition;
+  glm::vec4 cameraRight;
+  glm::vec4 cameraUp;
+  glm::vec4 time; // x: seconds since start, y: frame delta
+};
+
+class FrameUniformBuffer {
+public:
+  static constexpr GLuint binding = 0;
+
+  FrameUniformBuffer();
+
+  // Uploads the block for this frame and binds it for the draws that follow.
+  // The previous frame's region is fenced here, after all of its draws.
+  void update(const FrameUniforms &data);
+
+private:
+  StreamBuffer stream;
+  bool pending = false;
+};
+
+#endif // FRAME_UNIFORMS_HPP
@@ -0,0 +1,600 @@
+#include "gl_call_tracker.hpp"
+
+#if GL_CALL_TRACKING
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+namespace glCallTracker {
+
+namespace {
+
+// Entry point and the upper-case part of its glad pointer type.
+#define GL_TRACKED_FUNCTIONS(X)                                                \
+  X(UseProgram, USEPROGRAM)                                                    \
+  X(BindVertexArray, BINDVERTEXARRAY)                                          \
+  X(ActiveTexture, ACTIVETEXTURE)                                              \
+  X(BindTexture, BINDTEXTURE)                                                  \
+  X(BindBuffer, BINDBUFFER)                                                    \
+  X(BindBufferBase, BINDBUFFERBASE)                                            \
+  X(BindBufferRange, BINDBUFFERRANGE)                                          \
+  X(BindFramebuffer, BINDFRAMEBUFFER)                                          \
+  X(Enable, ENABLE)                                                            \
+  X(Disable, DISABLE)                                                          \
+  X(BlendFunc, BLENDFUNC)                                                      \
+  X(DepthMask, DEPTHMASK)                                                      \
+  X(DepthFunc, DEPTHFUNC)                                                      \
+  X(PolygonMode, POLYGONMODE)                                                  \
+  X(ColorMask, COLORMASK)                                                      \
+  X(Viewport, VIEWPORT)                                                        \
+  X(ClearColor, CLEARCOLOR)                                                    \
+  X(Uniform1i, UNIFORM1I)                                                      \
+  X(Uniform1f, UNIFORM1F)                                                      \
+  X(Uniform3fv, UNIFORM3FV)                                                    \
+  X(UniformMatrix4fv, UNIFORMMATRIX4FV)                                        \
+  X(LinkProgram, LINKPROGRAM)                                                  \
+  X(ProgramBinary, PROGRAMBINARY)                                              \
+  X(DeleteProgram, DELETEPROGRAM)                                              \
+  X(DeleteTextures, DELETETEXTURES)                                            \
+  X(DeleteBuffers, DELETEBUFFERS)                                              \
+  X(DeleteVertexArrays, DELETEVERTEXARRAYS)                                    \
+  X(DeleteFramebuffers, DELETEFRAMEBUFFERS)                                    \
+  X(DrawArrays, DRAWARRAYS)                                                    \
+  X(DrawArraysInstanced, DRAWARRAYSINSTANCED)                                  \
+  X(DrawArraysInstancedBaseInstance, DRAWARRAYSINSTANCEDBASEINSTANCE)          \
+  X(DrawElements, DRAWELEMENTS)                                                \
+  X(BufferData, BUFFERDATA)                                                    \
+  X(BufferSubData, BUFFERSUBDATA)                                              \
+  X(BufferStorage, BUFFERSTORAGE)                                              \
+  X(TexSubImage2D, TEXSUBIMAGE2D)                                              \
+  X(CompressedTexSubImage2D, COMPRESSEDTEXSUBIMAGE2D)                          \
+  X(MapBufferRange, MAPBUFFERRANGE)                                            \
+  X(UnmapBuffer, UNMAPBUFFER)                                                  \
+  X(Clear, CLEAR)                                                              \
+  X(BlitFramebuffer, BLITFRAMEBUFFER)                                          \
+  X(FenceSync, FENCESYNC)                                                      \
+  X(ClientWaitSync, CLIENTWAITSYNC)                                            \
+  X(DeleteSync, DELETESYNC)                                                    \
+  X(BeginQuery, BEGINQUERY)                                                    \
+  X(EndQuery, ENDQUERY)                                                        \
+  X(GetQueryObjectiv, GETQUERYOBJECTIV)                                        \
+  X(GetQueryObjectui64v, GETQUERYOBJECTUI64V)
+
+enum Function {
+#define X(name, type) name,
+  GL_TRACKED_FUNCTIONS(X)
+#undef X
+      FunctionCount
+};
+
+const char *functionNames[FunctionCount] = {
+#define X(name, type) "gl" #name,
+    GL_TRACKED_FUNCTIONS(X)
+#undef X
+};
+
+#define X(name, type) PFNGL##type##PROC real##name = nullptr;
+GL_TRACKED_FUNCTIONS(X)
+#undef X
+
+// Last value set, once one has been.
+template <typename T> struct Shadow {
+  T value{};
+  bool known = false;
+
+  // False when value is already what was set.
+  bool set(const T &next) {
+    if (known && value == next)
+      return false;
+    value = next;
+    known = true;
+    return true;
+  }
+};
+
+template <typename Map, typename Key, typename Value>
+bool setBinding(Map &map, const Key &key, const Value &value) {
+  auto it = map.find(key);
+  if (it != map.end() && it->second == value)
+    return false;
+  map[key] = value;
+  return true;
+}
+
+std::uint64_t pairKey(std::uint32_t high, std::uint32_t low) {
+  return static_cast<std::uint64_t>(high) << 32 | low;
+}
+
+struct IndexedBinding {
+  GLuint buffer;
+  GLintptr offset;
+  GLsizeiptr size;
+
+  bool operator==(const IndexedBinding &other) const {
+    return buffer == other.buffer && offset == other.offset &&
+           size == other.size;
+  }
+};
+
+// What the wrapped calls have set. Maps only grow when a new unit, target,
+// capability or uniform shows up, so the frame loop settles to no
+// allocations.
+struct State {
+  Shadow<GLuint> program;
+  Shadow<GLuint> vertexArray;
+  Shadow<GLenum> activeTexture;
+  std::unordered_map<std::uint64_t, GLuint> textures; // (unit, target)
+  std::unordered_map<GLenum, GLuint> buffers;
+  std::unordered_map<std::uint64_t, IndexedBinding> indexedBuffers;
+  Shadow<GLuint> drawFramebuffer;
+  Shadow<GLuint> readFramebuffer;
+  std::unordered_map<GLenum, bool> capabilities;
+  Shadow<std::array<GLenum, 2>> blendFunc;
+  Shadow<GLboolean> depthMask;
+  Shadow<GLenum> depthFunc;
+  Shadow<GLenum> polygonMode;
+  Shadow<std::array<GLboolean, 4>> colorMask;
+  Shadow<std::array<GLint, 4>> viewport;
+  Shadow<std::array<GLfloat, 4>> clearColor;
+  // Last value of each uniform, keyed by (program, location).
+  std::unordered_map<std::uint64_t, std::vector<unsigned char>> uniforms;
+};
+
+State state;
+bool installed = false;
+
+Counters frame;
+std::uint64_t functionCalls[FunctionCount];
+std::uint64_t functionRedundant[FunctionCount];
+
+Counters last;
+FunctionCounters lastFunctions[FunctionCount];
+int lastFunctionCount = 0;
+
+void countCall(Function function) {
+  ++frame.calls;
+  ++functionCalls[function];
+}
+
+void countSet(Function function, bool changed) {
+  countCall(function);
+  if (changed) {
+    ++frame.stateChanges;
+  } else {
+    ++frame.redundant;
+    ++functionRedundant[function];
+  }
+}
+
+void setUniform(Function function, GLint location, const void *data,
+                std::size_t bytes) {
+  // Location -1 is silently ignored by GL.
+  if (location < 0) {
+    countSet(function, false);
+    return;
+  }
+  if (!state.program.known) {
+    countSet(function, true);
+    return;
+  }
+  std::vector<unsigned char> &value = state.uniforms[pairKey(
+      state.program.value, static_cast<std::uint32_t>(location))];
+  bool changed =
+      value.size() != bytes || std::memcmp(value.data(), data, bytes) != 0;
+  if (changed)
+    value.assign(static_cast<const unsigned char *>(data),
+                 static_cast<const unsigned char *>(data) + bytes);
+  countSet(function, changed);
+}
+
+// Linking or deleting a program resets its uniforms.
+void forgetUniforms(GLuint program) {
+  for (auto it = state.uniforms.begin(); it != state.uniforms.end();) {
+    if (it->first >> 32 == program)
+      it = state.uniforms.erase(it);
+    else
+      ++it;
+  }
+}
+
+std::uint64_t texelBytes(GLenum format, GLenum type) {
+  std::uint64_t components = format == GL_RED                       ? 1
+                             : format == GL_RG                      ? 2
+                             : format == GL_RGB || format == GL_BGR ? 3
+                                                                    : 4;
+  std::uint64_t size =
+      type == GL_FLOAT || type == GL_INT || type == GL_UNSIGNED_INT ? 4
+      : type == GL_HALF_FLOAT || type == GL_SHORT ||
+              type == GL_UNSIGNED_SHORT
+          ? 2
+          : 1;
+  return components * size;
+}
+
+void APIENTRY wrapUseProgram(GLuint program) {
+  countSet(UseProgram, state.program.set(program));
+  realUseProgram(program);
+}
+
+void APIENTRY wrapBindVertexArray(GLuint array) {
+  bool changed = state.vertexArray.set(array);
+  // The element buffer binding belongs to the VAO.
+  if (changed)
+    state.buffers.erase(GL_ELEMENT_ARRAY_BUFFER);
+  countSet(BindVertexArray, changed);
+  realBindVertexArray(array);
+}
+
+void APIENTRY wrapActiveTexture(GLenum texture) {
+  countSet(ActiveTexture, state.activeTexture.set(texture));
+  realActiveTexture(texture);
+}
+
+void APIENTRY wrapBindTexture(GLenum target, GLuint texture) {
+  GLenum unit =
+      state.activeTexture.known ? state.activeTexture.value : GL_TEXTURE0;
+  countSet(BindTexture,
+           setBinding(state.textures, pairKey(unit, target), texture));
+  realBindTexture(target, texture);
+}
+
+void APIENTRY wrapBindBuffer(GLenum target, GLuint buffer) {
+  countSet(BindBuffer, setBinding(state.buffers, target, buffer));
+  realBindBuffer(target, buffer);
+}
+
+void APIENTRY wrapBindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+  // Also binds the generic target.
+  state.buffers[target] = buffer;
+  countSet(BindBufferBase, setBinding(state.indexedBuffers,
+                                      pairKey(target, index),
+                                      IndexedBinding{buffer, 0, -1}));
+  realBindBufferBase(target, index, buffer);
+}
+
+void APIENTRY wrapBindBufferRange(GLenum target, GLuint index, GLuint buffer,
+                                  GLintptr offset, GLsizeiptr size) {
+  state.buffers[target] = buffer;
+  countSet(BindBufferRange, setBinding(state.indexedBuffers,
+                                       pairKey(target, index),
+                                       IndexedBinding{buffer, offset, size}));
+  realBindBufferRange(target, index, buffer, offset, size);
+}
+
+void APIENTRY wrapBindFramebuffer(GLenum target, GLuint framebuffer) {
+  bool changed = false;
+  if (target != GL_READ_FRAMEBUFFER)
+    changed |= state.drawFramebuffer.set(framebuffer);
+  if (target != GL_DRAW_FRAMEBUFFER)
+    changed |= state.readFramebuffer.set(framebuffer);
+  countSet(BindFramebuffer, changed);
+  realBindFramebuffer(target, framebuffer);
+}
+
+void APIENTRY wrapEnable(GLenum cap) {
+  countSet(Enable, setBinding(state.capabilities, cap, true));
+  realEnable(cap);
+}
+
+void APIENTRY wrapDisable(GLenum cap) {
+  countSet(Disable, setBinding(state.capabilities, cap, false));
+  realDisable(cap);
+}
+
+void APIENTRY wrapBlendFunc(GLenum source, GLenum destination) {
+  countSet(BlendFunc, state.blendFunc.set({source, destination}));
+  realBlendFunc(source, destination);
+}
+
+void APIENTRY wrapDepthMask(GLboolean flag) {
+  countSet(DepthMask, state.depthMask.set(flag));
+  realDepthMask(flag);
+}
+
+void APIENTRY wrapDepthFunc(GLenum func) {
+  countSet(DepthFunc, state.depthFunc.set(func));
+  realDepthFunc(func);
+}
+
+void APIENTRY wrapPolygonMode(GLenum face, GLenum mode) {
+  // Core profile only takes GL_FRONT_AND_BACK.
+  countSet(PolygonMode,
+           face != GL_FRONT_AND_BACK || state.polygonMode.set(mode));
+  realPolygonMode(face, mode);
+}
+
+void APIENTRY wrapColorMask(GLboolean red, GLboolean green, GLboolean blue,
+                            GLboolean alpha) {
+  countSet(ColorMask, state.colorMask.set({red, green, blue, alpha}));
+  realColorMask(red, green, blue, alpha);
+}
+
+void APIENTRY wrapViewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+  countSet(Viewport, state.viewport.set({x, y, width, height}));
+  realViewport(x, y, width, height);
+}
+
+void APIENTRY wrapClearColor(GLfloat red, GLfloat green, GLfloat blue,
+                             GLfloat alpha) {
+  countSet(ClearColor, state.clearColor.set({red, green, blue, alpha}));
+  realClearColor(red, green, blue, alpha);
+}
+
+void APIENTRY wrapUniform1i(GLint location, GLint value) {
+  setUniform(Uniform1i, location, &value, sizeof(value));
+  realUniform1i(location, value);
+}
+
+void APIENTRY wrapUniform1f(GLint location, GLfloat value) {
+  setUniform(Uniform1f, location, &value, sizeof(value));
+  realUniform1f(location, value);
+}
+
+void APIENTRY wrapUniform3fv(GLint location, GLsizei count,
+                             const GLfloat *value) {
+  setUniform(Uniform3fv, location, value, sizeof(GLfloat) * 3 * count);
+  realUniform3fv(location, count, value);
+}
+
+void APIENTRY wrapUniformMatrix4fv(GLint location, GLsizei count,
+                                   GLboolean transpose, const GLfloat *value) {
+  setUniform(UniformMatrix4fv, location, value, sizeof(GLfloat) * 16 * count);
+  realUniformMatrix4fv(location, count, transpose, value);
+}
+
+void APIENTRY wrapLinkProgram(GLuint program) {
+  countCall(LinkProgram);
+  forgetUniforms(program);
+  realLinkProgram(program);
+}
+
+void APIENTRY wrapProgramBinary(GLuint program, GLenum binaryFormat,
+                                const void *binary, GLsizei length) {
+  countCall(ProgramBinary);
+  forgetUniforms(program);
+  realProgramBinary(program, binaryFormat, binary, length);
+}
+
+void APIENTRY wrapDeleteProgram(GLuint program) {
+  countCall(DeleteProgram);
+  forgetUniforms(program);
+  realDeleteProgram(program);
+}
+
+// Deleting a bound object reverts its bindings to 0.
+void APIENTRY wrapDeleteTextures(GLsizei n, const GLuint *textures) {
+  countCall(DeleteTextures);
+  for (auto &binding : state.textures)
+    if (std::find(textures, textures + n, binding.second) != textures + n)
+      binding.second = 0;
+  realDeleteTextures(n, textures);
+}
+
+void APIENTRY wrapDeleteBuffers(GLsizei n, const GLuint *buffers) {
+  countCall(DeleteBuffers);
+  for (auto &binding : state.buffers)
+    if (std::find(buffers, buffers + n, binding.second) != buffers + n)
+      binding.second = 0;
+  for (auto &binding : state.indexedBuffers)
+    if (std::find(buffers, buffers + n, binding.second.buffer) != buffers + n)
+      binding.second = IndexedBinding{0, 0, -1};
+  realDeleteBuffers(n, buffers);
+}
+
+void APIENTRY wrapDeleteVertexArrays(GLsizei n, const GLuint *arrays) {
+  countCall(DeleteVertexArrays);
+  if (std::find(arrays, arrays + n, state.vertexArray.value) != arrays + n)
+    state.vertexArray.value = 0;
+  realDeleteVertexArrays(n, arrays);
+}
+
+void APIENTRY wrapDeleteFramebuffers(GLsizei n, const GLuint *framebuffers) {
+  countCall(DeleteFramebuffers);
+  const GLuint *end = framebuffers + n;
+  if (std::find(framebuffers, end, state.drawFramebuffer.value) != end)
+    state.drawFramebuffer.value = 0;
+  if (std::find(framebuffers, end, state.readFramebuffer.value) != end)
+    state.readFramebuffer.value = 0;
+  realDeleteFramebuffers(n, framebuffers);
+}
+
+void APIENTRY wrapDrawArrays(GLenum mode, GLint first, GLsizei count) {
+  countCall(DrawArrays);
+  ++frame.draws;
+  realDrawArrays(mode, first, count);
+}
+
+void APIENTRY wrapDrawArraysInstanced(GLenum mode, GLint first,
+                                      GLsizei count, GLsizei instances) {
+  countCall(DrawArraysInstanced);
+  ++frame.draws;
+  realDrawArraysInstanced(mode, first, count, instances);
+}
+
+void APIENTRY wrapDrawArraysInstancedBaseInstance(GLenum mode, GLint first,
+                                                  GLsizei count,
+                                                  GLsizei instances,
+                                                  GLuint baseInstance) {
+  countCall(DrawArraysInstancedBaseInstance);
+  ++frame.draws;
+  realDrawArraysInstancedBaseInstance(mode, first, count, instances,
+                                      baseInstance);
+}
+
+void APIENTRY wrapDrawElements(GLenum mode, GLsizei count, GLenum type,
+                               const void *indices) {
+  countCall(DrawElements);
+  ++frame.draws;
+  realDrawElements(mode, count, type, indices);
+}
+
+void APIENTRY wrapBufferData(GLenum target, GLsizeiptr size, const void *data,
+                             GLenum usage) {
+  countCall(BufferData);
+  if (data)
+    frame.uploadBytes += size;
+  realBufferData(target, size, data, usage);
+}
+
+void APIENTRY wrapBufferSubData(GLenum target, GLintptr offset,
+                                GLsizeiptr size, const void *data) {
+  countCall(BufferSubData);
+  frame.uploadBytes += size;
+  realBufferSubData(target, offset, size, data);
+}
+
+void APIENTRY wrapBufferStorage(GLenum target, GLsizeiptr size,
+                                const void *data, GLbitfield flags) {
+  countCall(BufferStorage);
+  if (data)
+    frame.uploadBytes += size;
+  realBufferStorage(target, size, data, flags);
+}
+
+void APIENTRY wrapTexSubImage2D(GLenum target, GLint level, GLint xoffset,
+                                GLint yoffset, GLsizei width, GLsizei height,
+                                GLenum format, GLenum type,
+                                const void *pixels) {
+  countCall(TexSubImage2D);
+  frame.uploadBytes += static_cast<std::uint64_t>(width) * height *
+                       texelBytes(format, type);
+  realTexSubImage2D(target, level, xoffset, yoffset, width, height, format,
+                    type, pixels);
+}
+
+void APIENTRY wrapCompressedTexSubImage2D(GLenum target, GLint level,
+                                          GLint xoffset, GLint yoffset,
+                                          GLsizei width, GLsizei height,
+                                          GLenum format, GLsizei imageSize,
+                                          const void *data) {
+  countCall(CompressedTexSubImage2D);
+  frame.uploadBytes += imageSize;
+  realCompressedTexSubImage2D(target, level, xoffset, yoffset, width, height,
+                              format, imageSize, data);
+}
+
+// What gets written into a mapping is reported by its owner through
+// countUpload().
+void *APIENTRY wrapMapBufferRange(GLenum target, GLintptr offset,
+                                  GLsizeiptr length, GLbitfield access) {
+  countCall(MapBufferRange);
+  return realMapBufferRange(target, offset, length, access);
+}
+
+GLboolean APIENTRY wrapUnmapBuffer(GLenum target) {
+  countCall(UnmapBuffer);
+  return realUnmapBuffer(target);
+}
+
+void APIENTRY wrapClear(GLbitfield mask) {
+  countCall(Clear);
+  realClear(mask);
+}
+
+void APIENTRY wrapBlitFramebuffer(GLint srcX0, GLint srcY0, GLint srcX1,
+                                  GLint srcY1, GLint dstX0, GLint dstY0,
+                                  GLint dstX1, GLint dstY1, GLbitfield mask,
+                                  GLenum filter) {
+  countCall(BlitFramebuffer);
+  realBlitFramebuffer(srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1,
+                      mask, filter);
+}
+
+GLsync APIENTRY wrapFenceSync(GLenum condition, GLbitfield flags) {
+  countCall(FenceSync);
+  return realFenceSync(condition, flags);
+}
+
+GLenum APIENTRY wrapClientWaitSync(GLsync sync, GLbitfield flags,
+                                   GLuint64 timeout) {
+  countCall(ClientWaitSync);
+  return realClientWaitSync(sync, flags, timeout);
+}
+
+void APIENTRY wrapDeleteSync(GLsync sync) {
+  countCall(DeleteSync);
+  realDeleteSync(sync);
+}
+
+void APIENTRY wrapBeginQuery(GLenum target, GLuint id) {
+  countCall(BeginQuery);
+  realBeginQuery(target, id);
+}
+
+void APIENTRY wrapEndQuery(GLenum target) {
+  countCall(EndQuery);
+  realEndQuery(target);
+}
+
+void APIENTRY wrapGetQueryObjectiv(GLuint id, GLenum pname, GLint *params) {
+  countCall(GetQueryObjectiv);
+  realGetQueryObjectiv(id, pname, params);
+}
+
+void APIENTRY wrapGetQueryObjectui64v(GLuint id, GLenum pname,
+                                      GLuint64 *params) {
+  countCall(GetQueryObjectui64v);
+  realGetQueryObjectui64v(id, pname, params);
+}
+
+} // namespace
+
+void install() {
+  if (installed)
+    return;
+#define X(name, type)                                                          \
+  if (glad_gl##name) {                                                         \
+    real##name = glad_gl##name;                                                \
+    glad_gl##name = wrap##name;                                                \
+  }
+  GL_TRACKED_FUNCTIONS(X)
+#undef X
+  installed = true;
+}
+
+bool isInstalled() { return installed; }
+
+void endFrame() {
+  if (!installed)
+    return;
+  last = frame;
+  frame = Counters();
+
+  lastFunctionCount = 0;
+  for (int i = 0; i < FunctionCount; ++i) {
+    if (!functionCalls[i])
+      continue;
+    FunctionCounters &function = lastFunctions[lastFunctionCount++];
+    function.name = functionNames[i];
+    function.calls = functionCalls[i];
+    function.redundant = functionRedundant[i];
+    functionCalls[i] = 0;
+    functionRedundant[i] = 0;
+  }
+  std::sort(lastFunctions, lastFunctions + lastFunctionCount,
+            [](const FunctionCounters &a, const FunctionCounters &b) {
+              return a.calls > b.calls;
+            });
+}
+
+Counters lastFrame() { return last; }
+
+int lastFrameFunctions(FunctionCounters *functions, int maxFunctions) {
+  int count = std::min(lastFunctionCount, maxFunctions);
+  std::copy(lastFunctions, lastFunctions + count, functions);
+  return count;
+}
+
+void countUpload(std::size_t bytes) {
+  if (installed)
+    frame.uploadBytes += bytes;
+}
+
+} // namespace glCallTracker
+
+#endif // GL_CALL_TRACKING
@@ -0,0 +1,77 @@
+#ifndef GL_CALL_TRACKER_HPP
+#define GL_CALL_TRACKER_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// GL call instrumentation. With GL_CALL_TRACKING=1 (see CMakeLists.txt)
+// install() swaps glad's function pointers for the entry points the app uses
+// with wrappers that count calls, draws and uploaded bytes per frame, and
+// keep a shadow of the bound state to spot redundant sets: binding the
+// program, VAO, texture or buffer that is already bound, enabling what is
+// enabled, or setting a uniform of the current program to the value it
+// already has. Without it every call here compiles to nothing.
+//
+// Only calls made through glad are seen. The ImGui backend loads GL itself;
+// it saves and restores the state it touches, so the shadow stays valid.
+// GL thread only.
+
+#ifndef GL_CALL_TRACKING
+#define GL_CALL_TRACKING 0
+#endif
+
+namespace glCallTracker {
+
+struct Counters {
+  std::uint64_t calls = 0;
+  // Binds, enables and other state or uniform sets that changed something.
+  std::uint64_t stateChanges = 0;
+  // State or uniform sets that changed nothing.
+  std::uint64_t redundant = 0;
+  std::uint64_t draws = 0;
+  // Buffer and texture uploads, and writes to mapped streams reported
+  // through countUpload().
+  std::uint64_t uploadBytes = 0;
+};
+
+struct FunctionCounters {
+  const char *name = nullptr;
+  std::uint64_t calls = 0;
+  std::uint64_t redundant = 0;
+};
+
+#if GL_CALL_TRACKING
+
+// Wraps the entry points; needs glad loaded and the context current.
+void install();
+bool isInstalled();
+
+// Closes the current frame: its counters become lastFrame().
+void endFrame();
+
+Counters lastFrame();
+// Copies up to maxFunctions per-function counters of the last frame, most
+// called first, into functions and returns how many were written.
+int lastFrameFunctions(FunctionCounters *functions, int maxFunctions);
+
+// Bytes written into persistently mapped memory, which no GL call shows.
+void countUpload(std::size_t bytes);
+
+constexpr bool enabled = true;
+
+#else
+
+inline void install() {}
+inline bool isInstalled() { return false; }
+inline void endFrame() {}
+inline Counters lastFrame() { return Counters(); }
+inline int lastFrameFunctions(FunctionCounters *, int) { return 0; }
+inline void countUpload(std::size_t) {}
+
+constexpr bool enabled = false;
+
+#endif
+
+} // namespace glCallTracker
+
+#endif // GL_CALL_TRACKER_HPP
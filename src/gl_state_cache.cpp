@@ -0,0 +1,211 @@
+#include "gl_state_cache.hpp"
+
+#include <array>
+#include <cstring>
+#include <unordered_map>
+
+namespace glStateCache {
+
+namespace {
+
+template <typename T> struct Cached {
+  T value{};
+  bool known = false;
+};
+
+// Largest uniform set through the cache, a mat4.
+constexpr std::size_t maxUniformBytes = 16 * sizeof(GLfloat);
+
+struct UniformValue {
+  std::size_t bytes = 0;
+  unsigned char data[maxUniformBytes];
+};
+
+// Maps only grow when a new unit, target, capability or uniform shows up, so
+// the frame loop settles to no allocations.
+struct State {
+  Cached<GLuint> program;
+  Cached<GLuint> vertexArray;
+  Cached<GLenum> activeTexture;
+  std::unordered_map<std::uint64_t, GLuint> textures; // (unit, target)
+  std::unordered_map<GLenum, bool> capabilities;
+  Cached<std::array<GLenum, 2>> blendFunc;
+  Cached<GLboolean> depthMask;
+  Cached<GLenum> polygonMode;
+  std::unordered_map<std::uint64_t, UniformValue> uniforms; // (program, loc)
+};
+
+State state;
+bool passThrough = false;
+
+Counters frame;
+Counters last;
+
+std::uint64_t pairKey(std::uint32_t high, std::uint32_t low) {
+  return static_cast<std::uint64_t>(high) << 32 | low;
+}
+
+// True when the call has to reach GL. Records the value either way.
+template <typename T> bool change(Cached<T> &cached, const T &value) {
+  if (!passThrough && cached.known && cached.value == value) {
+    ++frame.skipped;
+    return false;
+  }
+  cached.value = value;
+  cached.known = true;
+  ++frame.issued;
+  return true;
+}
+
+template <typename Map, typename Key, typename Value>
+bool change(Map &map, const Key &key, const Value &value) {
+  auto it = map.find(key);
+  if (!passThrough && it != map.end() && it->second == value) {
+    ++frame.skipped;
+    return false;
+  }
+  map[key] = value;
+  ++frame.issued;
+  return true;
+}
+
+bool changeUniform(GLint location, const void *data, std::size_t bytes) {
+  if (!passThrough && location < 0) {
+    ++frame.skipped;
+    return false;
+  }
+  // Nothing to key the value on.
+  if (!state.program.known || !state.program.value || location < 0) {
+    ++frame.issued;
+    return true;
+  }
+  UniformValue &value = state.uniforms[pairKey(
+      state.program.value, static_cast<std::uint32_t>(location))];
+  if (!passThrough && value.bytes == bytes &&
+      std::memcmp(value.data, data, bytes) == 0) {
+    ++frame.skipped;
+    return false;
+  }
+  value.bytes = bytes;
+  std::memcpy(value.data, data, bytes);
+  ++frame.issued;
+  return true;
+}
+
+} // namespace
+
+void useProgram(GLuint program) {
+  if (change(state.program, program))
+    glUseProgram(program);
+}
+
+void bindVertexArray(GLuint vertexArray) {
+  if (change(state.vertexArray, vertexArray))
+    glBindVertexArray(vertexArray);
+}
+
+void activeTexture(GLenum unit) {
+  if (change(state.activeTexture, unit))
+    glActiveTexture(unit);
+}
+
+void bindTexture(GLenum target, GLuint texture) {
+  if (!state.activeTexture.known) {
+    // Could be any unit; none of the cached bindings can be trusted.
+    state.textures.clear();
+    ++frame.issued;
+    glBindTexture(target, texture);
+    return;
+  }
+  if (change(state.textures, pairKey(state.activeTexture.value, target),
+             texture))
+    glBindTexture(target, texture);
+}
+
+void enable(GLenum capability) {
+  if (change(state.capabilities, capability, true))
+    glEnable(capability);
+}
+
+void disable(GLenum capability) {
+  if (change(state.capabilities, capability, false))
+    glDisable(capability);
+}
+
+void blendFunc(GLenum source, GLenum destination) {
+  if (change(state.blendFunc, std::array<GLenum, 2>{source, destination}))
+    glBlendFunc(source, destination);
+}
+
+void depthMask(GLboolean mask) {
+  if (change(state.depthMask, mask))
+    glDepthMask(mask);
+}
+
+void polygonMode(GLenum mode) {
+  if (change(state.polygonMode, mode))
+    glPolygonMode(GL_FRONT_AND_BACK, mode);
+}
+
+void uniform1i(GLint location, GLint value) {
+  if (changeUniform(location, &value, sizeof(value)))
+    glUniform1i(location, value);
+}
+
+void uniform1f(GLint location, GLfloat value) {
+  if (changeUniform(location, &value, sizeof(value)))
+    glUniform1f(location, value);
+}
+
+void uniform3fv(GLint location, const GLfloat *value) {
+  if (changeUniform(location, value, 3 * sizeof(GLfloat)))
+    glUniform3fv(location, 1, value);
+}
+
+void uniformMatrix4fv(GLint location, const GLfloat *value) {
+  if (changeUniform(location, value, 16 * sizeof(GLfloat)))
+    glUniformMatrix4fv(location, 1, GL_FALSE, value);
+}
+
+void deleteProgram(GLuint program) {
+  for (auto it = state.uniforms.begin(); it != state.uniforms.end();) {
+    if (it->first >> 32 == program)
+      it = state.uniforms.erase(it);
+    else
+      ++it;
+  }
+  glDeleteProgram(program);
+}
+
+void deleteVertexArrays(GLsizei count, const GLuint *vertexArrays) {
+  // Deleting the bound VAO binds 0.
+  for (GLsizei i = 0; i < count; ++i) {
+    if (state.vertexArray.value == vertexArrays[i])
+      state.vertexArray.value = 0;
+  }
+  glDeleteVertexArrays(count, vertexArrays);
+}
+
+void deleteTextures(GLsizei count, const GLuint *textures) {
+  // Deleting a bound texture binds 0 on every unit it was bound to.
+  for (GLsizei i = 0; i < count; ++i) {
+    for (auto &binding : state.textures) {
+      if (binding.second == textures[i])
+        binding.second = 0;
+    }
+  }
+  glDeleteTextures(count, textures);
+}
+
+void setPassThrough(bool enable) { passThrough = enable; }
+
+bool isPassThrough() { return passThrough; }
+
+void endFrame() {
+  last = frame;
+  frame = Counters();
+}
+
+Counters lastFrame() { return last; }
+
+} // namespace glStateCache
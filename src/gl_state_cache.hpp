@@ -0,0 +1,61 @@
+#ifndef GL_STATE_CACHE_HPP
+#define GL_STATE_CACHE_HPP
+
+#include <glad/glad.h>
+#include <cstdint>
+
+// Remembers the GL state set through it and drops calls that would not
+// change anything: the bound program, VAO and textures, the active texture
+// unit, enabled capabilities, blend function, depth mask, polygon mode and
+// the uniform values of each program. A value is only trusted once it has
+// been set here, so the first call of each always reaches the driver.
+//
+// Everything in the app that touches this state goes through the cache,
+// including creation and deletion of the objects; a raw call would leave it
+// stale. ImGui restores what it changes, so it may bypass it. GL thread
+// only.
+namespace glStateCache {
+
+struct Counters {
+  // Calls passed on to GL.
+  std::uint64_t issued = 0;
+  // Calls dropped because the state already had that value.
+  std::uint64_t skipped = 0;
+};
+
+void useProgram(GLuint program);
+void bindVertexArray(GLuint vertexArray);
+void activeTexture(GLenum unit);
+// Binds to the active unit.
+void bindTexture(GLenum target, GLuint texture);
+void enable(GLenum capability);
+void disable(GLenum capability);
+void blendFunc(GLenum source, GLenum destination);
+void depthMask(GLboolean mask);
+// Both faces, the only mode core profile has.
+void polygonMode(GLenum mode);
+
+// Uniforms of the current program. Location -1 is skipped, as GL would
+// ignore it.
+void uniform1i(GLint location, GLint value);
+void uniform1f(GLint location, GLfloat value);
+void uniform3fv(GLint location, const GLfloat *value);
+void uniformMatrix4fv(GLint location, const GLfloat *value);
+
+// Delete and clear the cached bindings and uniforms of the objects, whose
+// names GL may hand out again.
+void deleteProgram(GLuint program);
+void deleteVertexArrays(GLsizei count, const GLuint *vertexArrays);
+void deleteTextures(GLsizei count, const GLuint *textures);
+
+// Pass every call on, to compare against the cached path. Still counted.
+void setPassThrough(bool passThrough);
+bool isPassThrough();
+
+// Closes the current frame: its counters become lastFrame().
+void endFrame();
+Counters lastFrame();
+
+} // namespace glStateCache
+
+#endif // GL_STATE_CACHE_HPP
@@ -0,0 +1,128 @@
+#include "gpu_profiler.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+GpuProfiler::GpuProfiler() {
+  for (Slot &slot : slots)
+    glGenQueries(maxPasses, slot.queries);
+}
+
+int GpuProfiler::addPass(const char *name) {
+  if (passCount == maxPasses) {
+    std::cerr << "GPU profiler: no room for pass " << name << ", "
+              << maxPasses << " passes at most" << std::endl;
+    return -1;
+  }
+  passes[passCount].name = name;
+  return passCount++;
+}
+
+void GpuProfiler::beginFrame() {
+  ++frame;
+  Slot &slot = slots[frame % latency];
+  for (int i = 0; i < passCount; ++i) {
+    if (!slot.issued[i])
+      continue;
+    slot.issued[i] = false;
+
+    GLint available = 0;
+    glGetQueryObjectiv(slot.queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+      ++dropped;
+      continue;
+    }
+    GLuint64 nanoseconds = 0;
+    glGetQueryObjectui64v(slot.queries[i], GL_QUERY_RESULT, &nanoseconds);
+
+    Pass &pass = passes[i];
+    pass.gpu[pass.next] = nanoseconds * 1e-6f;
+    pass.cpu[pass.next] = slot.cpu[i];
+    pass.next = (pass.next + 1) % historySize;
+    pass.count = std::min(pass.count + 1, historySize);
+  }
+}
+
+void GpuProfiler::begin(int pass) {
+  if (pass < 0)
+    return;
+  glBeginQuery(GL_TIME_ELAPSED, slots[frame % latency].queries[pass]);
+  passStart = std::chrono::steady_clock::now();
+}
+
+void GpuProfiler::end(int pass) {
+  if (pass < 0)
+    return;
+  Slot &slot = slots[frame % latency];
+  slot.cpu[pass] = std::chrono::duration<float, std::milli>(
+                       std::chrono::steady_clock::now() - passStart)
+                       .count();
+  glEndQuery(GL_TIME_ELAPSED);
+  slot.issued[pass] = true;
+}
+
+int GpuProfiler::getPassCount() const { return passCount; }
+
+const char *GpuProfiler::getPassName(int pass) const {
+  return passes[pass].name;
+}
+
+const float *GpuProfiler::getGpuHistory(int pass) const {
+  return passes[pass].gpu;
+}
+
+const float *GpuProfiler::getCpuHistory(int pass) const {
+  return passes[pass].cpu;
+}
+
+int GpuProfiler::getHistoryOffset(int pass) const {
+  return passes[pass].count < historySize ? 0 : passes[pass].next;
+}
+
+int GpuProfiler::getHistoryCount(int pass) const { return passes[pass].count; }
+
+float GpuProfiler::getLastGpu(int pass) const {
+  const Pass &p = passes[pass];
+  return p.count ? p.gpu[(p.next + historySize - 1) % historySize] : 0.0f;
+}
+
+float GpuProfiler::getLastCpu(int pass) const {
+  const Pass &p = passes[pass];
+  return p.count ? p.cpu[(p.next + historySize - 1) % historySize] : 0.0f;
+}
+
+GpuProfiler::Percentiles GpuProfiler::getGpuPercentiles(int pass) const {
+  return percentiles(passes[pass].gpu, passes[pass].count);
+}
+
+GpuProfiler::Percentiles GpuProfiler::getCpuPercentiles(int pass) const {
+  return percentiles(passes[pass].cpu, passes[pass].count);
+}
+
+std::uint64_t GpuProfiler::getDroppedSamples() const { return dropped; }
+
+void GpuProfiler::release() {
+  for (Slot &slot : slots) {
+    glDeleteQueries(maxPasses, slot.queries);
+    std::fill(slot.issued, slot.issued + maxPasses, false);
+  }
+}
+
+GpuProfiler::Percentiles GpuProfiler::percentiles(const float *samples,
+                                                  int count) const {
+  Percentiles result;
+  if (!count)
+    return result;
+  // The ring holds the most recent `count` samples; order does not matter.
+  std::copy(samples, samples + count, scratch.begin());
+  auto rank = [&](float fraction) {
+    int index = std::min(count - 1, static_cast<int>(fraction * count));
+    std::nth_element(scratch.begin(), scratch.begin() + index,
+                     scratch.begin() + count);
+    return scratch[index];
+  };
+  result.p50 = rank(0.50f);
+  result.p95 = rank(0.95f);
+  result.p99 = rank(0.99f);
+  return result;
+}
@@ -0,0 +1,86 @@
+#ifndef GPU_PROFILER_HPP
+#define GPU_PROFILER_HPP
+
+#include <glad/glad.h>
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+// Per-pass GPU times from GL_TIME_ELAPSED queries, with the CPU time spent
+// issuing the same pass next to them. Results are read `latency` frames
+// after they were issued and only if the driver already has them, so the
+// CPU never waits on the GPU; late results are dropped and counted.
+//
+// Elapsed-time queries cannot nest: passes are begun and ended one after
+// the other.
+class GpuProfiler {
+public:
+  static constexpr int maxPasses = 8;
+  static constexpr int historySize = 240;
+  static constexpr int latency = 4;
+
+  // Milliseconds over the history.
+  struct Percentiles {
+    float p50 = 0.0f;
+    float p95 = 0.0f;
+    float p99 = 0.0f;
+  };
+
+  GpuProfiler();
+  GpuProfiler(const GpuProfiler &) = delete;
+  GpuProfiler &operator=(const GpuProfiler &) = delete;
+
+  // Index for begin()/end(); name must outlive the profiler. -1 once
+  // maxPasses are taken, which begin()/end() ignore.
+  int addPass(const char *name);
+
+  // Collects the frame issued `latency` frames ago. Call before any pass.
+  void beginFrame();
+  void begin(int pass);
+  void end(int pass);
+
+  int getPassCount() const;
+  const char *getPassName(int pass) const;
+
+  // Ring of samples in milliseconds; the oldest is at getHistoryOffset().
+  const float *getGpuHistory(int pass) const;
+  const float *getCpuHistory(int pass) const;
+  int getHistoryOffset(int pass) const;
+  int getHistoryCount(int pass) const;
+  float getLastGpu(int pass) const;
+  float getLastCpu(int pass) const;
+  Percentiles getGpuPercentiles(int pass) const;
+  Percentiles getCpuPercentiles(int pass) const;
+
+  std::uint64_t getDroppedSamples() const;
+
+  void release();
+
+private:
+  struct Pass {
+    const char *name = "";
+    float gpu[historySize] = {};
+    float cpu[historySize] = {};
+    int next = 0;
+    int count = 0;
+  };
+
+  // Queries of one frame in flight.
+  struct Slot {
+    GLuint queries[maxPasses] = {};
+    bool issued[maxPasses] = {};
+    float cpu[maxPasses] = {};
+  };
+
+  Percentiles percentiles(const float *samples, int count) const;
+
+  std::array<Pass, maxPasses> passes;
+  int passCount = 0;
+  std::array<Slot, latency> slots;
+  int frame = -1;
+  std::chrono::steady_clock::time_point passStart;
+  std::uint64_t dropped = 0;
+  mutable std::array<float, historySize> scratch;
+};
+
+#endif // GPU_PROFILER_HPP
@@ -1,15 +1,25 @@
 #include "gui.hpp"
 
+#include <cfloat>
+#include <cstdio>
 #include <iostream>
 
 #include "GLFW/glfw3.h"
+#include "alloc_tracker.hpp"
+#include "gl_call_tracker.hpp"
+#include "gl_state_cache.hpp"
+#include "gpu_profiler.hpp"
 #include "imgui.h"
+#include "particle_renderer.hpp"
 #include "particle_system.hpp"
 #include <backends/imgui_impl_glfw.h>
 #include <backends/imgui_impl_opengl3.h>
 
-ImGuiModule::ImGuiModule(GLFWwindow *window, ParticleSystem &particleSystem)
-    : fps(0.0f), frameTime(0.0f), particleSystem(particleSystem) {
+ImGuiModule::ImGuiModule(GLFWwindow *window, ParticleSystem &particleSystem,
+                         ParticleRenderer &particleRenderer)
+    : fps(0.0f), frameTime(0.0f), simulationTime(0.0f),
+      particleResolutionDivisor(1), trimmedQuads(true), gpuProfiler(nullptr),
+      particleSystem(particleSystem), particleRenderer(particleRenderer) {
   IMGUI_CHECKVERSION();
   ImGui::CreateContext();
   ImGuiIO &io = ImGui::GetIO();
@@ -37,87 +47,154 @@ void ImGuiModule::beginFrame() {
 void ImGuiModule::render() {
   ImGui::Begin("Debug Information");
   ImGui::Text("FPS: %.1f", fps);
-  ImGui::Text("Frame Time: %.3f ms", frameTime);
-
-  ImGui::Separator();
-  ImGui::Text("Particle System Controls");
-
-  static float pps = particleSystem.getPPS();
-  if (ImGui::SliderFloat("Particles Per Second", &pps, 0.0f, 5000.0f)) {
-    particleSystem.setPPS(pps);
-  }
-
-  static float avgSpeed = particleSystem.getAverageSpeed();
-  if (ImGui::SliderFloat("Average Speed", &avgSpeed, 0.0f, 20.0f)) {
-    particleSystem.setAverageSpeed(avgSpeed);
-  }
-
-  static float gravityEffect = particleSystem.getGravityEffect();
-  if (ImGui::SliderFloat("Gravity Effect", &gravityEffect, -10.0f, 10.0f)) {
-    particleSystem.setGravityEffect(gravityEffect);
-  }
-
-  static float avgLifeLength = particleSystem.getAverageLifeLength();
-  if (ImGui::SliderFloat("Average Life Length", &avgLifeLength, 0.1f, 10.0f)) {
-    particleSystem.setAverageLifeLength(avgLifeLength);
-  }
-
-  static float avgScale = particleSystem.getAverageScale();
-  if (ImGui::SliderFloat("Average Scale", &avgScale, 0.1f, 5.0f)) {
-    particleSystem.setAverageScale(avgScale);
-  }
-
-  static float speedError = particleSystem.getSpeedError();
-  if (ImGui::SliderFloat("Speed Error", &speedError, 0.0f, 1.0f)) {
-    particleSystem.setSpeedError(speedError);
-  }
-
-  static float lifeError = particleSystem.getLifeError();
-  if (ImGui::SliderFloat("Life Error", &lifeError, 0.0f, 1.0f)) {
-    particleSystem.setLifeError(lifeError);
-  }
-
-  static float scaleError = particleSystem.getScaleError();
-  if (ImGui::SliderFloat("Scale Error", &scaleError, 0.0f, 1.0f)) {
-    particleSystem.setScaleError(scaleError);
+  ImGui::Text("Frame Time: %.3f ms", frameTime * 1000.0f);
+  ImGui::Text("Simulation Step: %.3f ms", simulationTime * 1000.0f);
+
+  if (gpuProfiler && gpuProfiler->getPassCount()) {
+    ImGui::Separator();
+    ImGui::Text("Pass ms      GPU p50  p95  p99 | CPU p50  p95  p99");
+    for (int i = 0; i < gpuProfiler->getPassCount(); ++i) {
+      GpuProfiler::Percentiles gpu = gpuProfiler->getGpuPercentiles(i);
+      GpuProfiler::Percentiles cpu = gpuProfiler->getCpuPercentiles(i);
+      ImGui::Text("%-10s %7.2f %4.2f %4.2f | %7.2f %4.2f %4.2f",
+                  gpuProfiler->getPassName(i), gpu.p50, gpu.p95, gpu.p99,
+                  cpu.p50, cpu.p95, cpu.p99);
+
+      char overlay[32];
+      int count = gpuProfiler->getHistoryCount(i);
+      int offset = gpuProfiler->getHistoryOffset(i);
+      ImGui::PushID(i);
+      std::snprintf(overlay, sizeof(overlay), "%.2f ms",
+                    gpuProfiler->getLastGpu(i));
+      ImGui::PlotLines("GPU", gpuProfiler->getGpuHistory(i), count, offset,
+                       overlay, 0.0f, FLT_MAX, ImVec2(0.0f, 40.0f));
+      std::snprintf(overlay, sizeof(overlay), "%.2f ms",
+                    gpuProfiler->getLastCpu(i));
+      ImGui::PlotLines("CPU", gpuProfiler->getCpuHistory(i), count, offset,
+                       overlay, 0.0f, FLT_MAX, ImVec2(0.0f, 40.0f));
+      ImGui::PopID();
+    }
+    ImGui::Text("Late GPU results dropped: %llu",
+                static_cast<unsigned long long>(
+                    gpuProfiler->getDroppedSamples()));
+  }
+
+  if (allocTracker::enabled) {
+    allocTracker::Counters heap = allocTracker::lastFrame();
+    ImGui::Text("Heap: %llu allocs, %llu frees, %.1f KB%s",
+                static_cast<unsigned long long>(heap.allocations),
+                static_cast<unsigned long long>(heap.frees),
+                heap.bytes / 1024.0f,
+                allocTracker::isStrict() ? " (strict)" : "");
+    allocTracker::ScopeCounters scopes[16];
+    int scopeCount = allocTracker::lastFrameScopes(scopes, 16);
+    for (int i = 0; i < scopeCount; ++i) {
+      ImGui::BulletText("%s: %llu allocs, %.1f KB", scopes[i].name,
+                        static_cast<unsigned long long>(
+                            scopes[i].counters.allocations),
+                        scopes[i].counters.bytes / 1024.0f);
+    }
   }
 
-  static bool randomRotation = particleSystem.isRandomRotation();
-  if (ImGui::Checkbox("Random Rotation", &randomRotation)) {
-    if (randomRotation) {
-      particleSystem.randomizeRotation();
-    } else {
-      particleSystem.disableRandomRotation();
+  glStateCache::Counters stateCache = glStateCache::lastFrame();
+  ImGui::Text("GL state cache: %llu issued, %llu skipped%s",
+              static_cast<unsigned long long>(stateCache.issued),
+              static_cast<unsigned long long>(stateCache.skipped),
+              glStateCache::isPassThrough() ? " (pass-through)" : "");
+
+  if (glCallTracker::isInstalled()) {
+    glCallTracker::Counters gl = glCallTracker::lastFrame();
+    ImGui::Text("GL: %llu calls, %llu state changes, %llu redundant",
+                static_cast<unsigned long long>(gl.calls),
+                static_cast<unsigned long long>(gl.stateChanges),
+                static_cast<unsigned long long>(gl.redundant));
+    ImGui::Text("GL: %llu draws, %.1f KB uploaded",
+                static_cast<unsigned long long>(gl.draws),
+                gl.uploadBytes / 1024.0f);
+    glCallTracker::FunctionCounters functions[16];
+    int functionCount = glCallTracker::lastFrameFunctions(functions, 16);
+    for (int i = 0; i < functionCount; ++i) {
+      if (functions[i].redundant)
+        ImGui::BulletText("%s: %llu (%llu redundant)", functions[i].name,
+                          static_cast<unsigned long long>(functions[i].calls),
+                          static_cast<unsigned long long>(
+                              functions[i].redundant));
+      else
+        ImGui::BulletText("%s: %llu", functions[i].name,
+                          static_cast<unsigned long long>(functions[i].calls));
     }
   }
 
-  static float direction[3] = {particleSystem.getDirection().x,
-                               particleSystem.getDirection().y,
-                               particleSystem.getDirection().z};
-  if (ImGui::InputFloat3("Direction", direction)) {
-    glm::vec3 dir =
-        glm::normalize(glm::vec3(direction[0], direction[1], direction[2]));
-    particleSystem.setDirection(dir, particleSystem.getDirectionDeviation());
-  }
+  ImGui::Separator();
+  ImGui::Text("Particle System Controls");
 
-  static float directionDeviation = particleSystem.getDirectionDeviation();
-  if (ImGui::SliderAngle("Direction Deviation", &directionDeviation, 0.0f,
-                         180.0f)) {
-    particleSystem.setDirection(
-        glm::normalize(glm::vec3(direction[0], direction[1], direction[2])),
-        directionDeviation);
+  // Edit a copy of the current block and publish it once, so everything
+  // changed this frame reaches the simulation together.
+  EmitterParams params = particleSystem.getParams();
+  bool changed = false;
+
+  bool compactStorage = params.storage == ParticleStorage::Compact;
+  if (ImGui::Checkbox("Compact Storage", &compactStorage)) {
+    params.storage =
+        compactStorage ? ParticleStorage::Compact : ParticleStorage::Full;
+    changed = true;
+  }
+  ImGui::Text("Particle Memory: %.1f KB",
+              particleSystem.getParticleBytes() / 1024.0f);
+  bool vertexPulling =
+      particleRenderer.getRenderPath() == ParticleRenderPath::Pulled;
+  if (ImGui::Checkbox("Vertex Pulling", &vertexPulling))
+    particleRenderer.setRenderPath(vertexPulling
+                                       ? ParticleRenderPath::Pulled
+                                       : ParticleRenderPath::Attributes);
+  ImGui::Checkbox("Trimmed Quads", &trimmedQuads);
+  const char *resolutions[] = {"Full", "Half", "Quarter"};
+  int resolution = particleResolutionDivisor == 4   ? 2
+                   : particleResolutionDivisor == 2 ? 1
+                                                    : 0;
+  if (ImGui::Combo("Particle Resolution", &resolution, resolutions, 3))
+    particleResolutionDivisor = 1 << resolution;
+  const StreamBuffer::Stats &stream = particleRenderer.getInstanceStreamStats();
+  ImGui::Text("Instance Stream: %llu stalls, %.2f ms waited, %llu resizes",
+              static_cast<unsigned long long>(stream.stalls),
+              stream.stallSeconds * 1000.0,
+              static_cast<unsigned long long>(stream.reallocations));
+
+  changed |= ImGui::SliderFloat("Particles Per Second", &params.pps, 0.0f,
+                                5000.0f);
+  changed |= ImGui::SliderFloat("Average Speed", &params.averageSpeed, 0.0f,
+                                20.0f);
+  changed |= ImGui::SliderFloat("Gravity Effect", &params.gravityEffect,
+                                -10.0f, 10.0f);
+  changed |= ImGui::SliderFloat("Average Life Length",
+                                &params.averageLifeLength, 0.1f, 10.0f);
+  changed |= ImGui::SliderFloat("Average Scale", &params.averageScale, 0.1f,
+                                5.0f);
+  changed |= ImGui::SliderFloat("Speed Error", &params.speedError, 0.0f, 1.0f);
+  changed |= ImGui::SliderFloat("Life Error", &params.lifeError, 0.0f, 1.0f);
+  changed |= ImGui::SliderFloat("Scale Error", &params.scaleError, 0.0f, 1.0f);
+  changed |= ImGui::Checkbox("Random Rotation", &params.randomRotation);
+
+  // Typed in unnormalized, normalized when published.
+  static float direction[3] = {params.direction.x, params.direction.y,
+                               params.direction.z};
+  if (ImGui::InputFloat3("Direction", direction)) {
+    glm::vec3 dir(direction[0], direction[1], direction[2]);
+    if (glm::length(dir) > 0.0f) {
+      params.direction = glm::normalize(dir);
+      changed = true;
+    }
   }
 
-  static float turbulenceStrength = particleSystem.getTurbulenceStrength();
-  if (ImGui::SliderFloat("Turbulence Strength", &turbulenceStrength, 0.0f,
-                         100.0f)) {
-    particleSystem.setScaleError(turbulenceStrength);
-  }
+  changed |= ImGui::SliderAngle("Direction Deviation",
+                                &params.directionDeviation, 0.0f, 180.0f);
+  changed |= ImGui::SliderFloat("Turbulence Strength",
+                                &params.turbulenceStrength, 0.0f, 100.0f);
+  changed |= ImGui::SliderFloat("Turbulence Scale", &params.turbulenceScale,
+                                0.0f, 100.0f);
 
-  static float turbulenceScale = particleSystem.getTurbulenceScale();
-  if (ImGui::SliderFloat("Turbulence Scale", &turbulenceScale, 0.0f, 100.0f)) {
-    particleSystem.setScaleError(turbulenceScale);
-  }
+  if (changed)
+    particleSystem.setParams(params);
 
   ImGui::End();
 
@@ -4,11 +4,14 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+class GpuProfiler;
+class ParticleRenderer;
 class ParticleSystem; // Forward declaration
 
 class ImGuiModule {
 public:
-    ImGuiModule(GLFWwindow* window, ParticleSystem& particleSystem);
+    ImGuiModule(GLFWwindow* window, ParticleSystem& particleSystem,
+                ParticleRenderer& particleRenderer);
     ~ImGuiModule();
 
     void beginFrame();
@@ -18,9 +21,17 @@ public:
 
     float fps;
     float frameTime;
+    float simulationTime;
+    // 1, 2 or 4: particles drawn at full, half or quarter resolution.
+    int particleResolutionDivisor;
+    // Draw particles as alpha-trimmed polygons when the atlas has them.
+    bool trimmedQuads;
+    // Per-pass timings to show, optional.
+    const GpuProfiler* gpuProfiler;
 
 private:
     ParticleSystem& particleSystem;
+    ParticleRenderer& particleRenderer;
 };
 
 #endif // GUI_HPP
@@ -0,0 +1,48 @@
+#ifndef MAILBOX_HPP
+#define MAILBOX_HPP
+
+#include <atomic>
+
+// Single-producer, single-consumer "latest value" slot (a triple buffer).
+// The producer overwrites whatever the consumer has not picked up yet, the
+// consumer always gets the newest complete value. Neither side ever blocks or
+// sees a half-written T.
+template <typename T> class Mailbox {
+public:
+  Mailbox() = default;
+  explicit Mailbox(const T &initial) {
+    for (T &slot : slots)
+      slot = initial;
+  }
+
+  Mailbox(const Mailbox &) = delete;
+  Mailbox &operator=(const Mailbox &) = delete;
+
+  // Producer side.
+  void write(const T &value) {
+    slots[back] = value;
+    back = shared.exchange(back | freshBit, std::memory_order_acq_rel) &
+           indexMask;
+  }
+
+  // Consumer side. Copies the newest value into value and returns true if
+  // one arrived since the last read.
+  bool read(T &value) {
+    if (!(shared.load(std::memory_order_acquire) & freshBit))
+      return false;
+    front = shared.exchange(front, std::memory_order_acq_rel) & indexMask;
+    value = slots[front];
+    return true;
+  }
+
+private:
+  static constexpr unsigned freshBit = 4;
+  static constexpr unsigned indexMask = 3;
+
+  T slots[3];
+  alignas(64) std::atomic<unsigned> shared{1};
+  alignas(64) unsigned back = 0;  // producer only
+  alignas(64) unsigned front = 2; // consumer only
+};
+
+#endif // MAILBOX_HPP
@@ -4,13 +4,34 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "alloc_tracker.hpp"
+#include "atlas_trim.hpp"
 #include "camera.hpp"
+#include "cpu_profiler.hpp"
+#include "cpu_dispatch.hpp"
+#include "frame_arena.hpp"
+#include "frame_uniforms.hpp"
+#include "gl_call_tracker.hpp"
+#include "gl_state_cache.hpp"
+#include "gpu_profiler.hpp"
 #include "gui.hpp"
+#include "offscreen_particles.hpp"
+#include "particle_renderer.hpp"
 #include "particle_system.hpp"
 #include "shader.hpp"
-#include "util.hpp"
-
+#include "simulation_pipeline.hpp"
+#include "static_batch.hpp"
+#include "stress_scene.hpp"
+#include "texture_manager.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
 
 // Settings
 const unsigned int SCR_WIDTH = 2880;
@@ -27,6 +48,12 @@ float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
 bool isMouseCaptured = true;
+// A stress scene drives the camera along its path until the user moves it.
+bool cameraOnScenePath = false;
+
+// CPU trace output, and how many frames F9 captures.
+const char *tracePath = "trace.json";
+const int traceHotkeyFrames = 120;
 
 void framebuffer_size_callback(GLFWwindow *window, int width, int height);
 void mouse_callback(GLFWwindow *window, double xpos, double ypos);
@@ -34,7 +61,72 @@ void scroll_callback(GLFWwindow *window, double xoffset, double yoffset);
 void processInput(GLFWwindow *window);
 void renderQuad();
 
-int main() {
+int main(int argc, char **argv) {
+  // --pipelined: simulate one frame ahead on a separate thread.
+  // --alloc-strict: abort if the frame loop allocates once it has settled.
+  // --gl-calls: count GL calls and redundant state sets, shown in the debug
+  // window.
+  // --no-state-cache: pass every state change on to GL, see glStateCache.
+  // --shader-cache <dir>: where linked programs are cached ("shader_cache").
+  // --no-shader-cache: always compile, e.g. to compare startup times.
+  // --texture-cache <dir>: where compressed mip chains are kept
+  // ("texture_cache").
+  // --no-texture-cache: decode and compress every texture on each start.
+  // --trace <file>: where CPU traces go ("trace.json"); F9 captures the next
+  // traceHotkeyFrames frames.
+  // --trace-frames <first> <count>: capture that frame range at startup.
+  // --stress <preset>: run a generated stress scene instead of the campfire,
+  // see stress_scene.hpp; --stress-<key> <value> sets any scene key, e.g.
+  // --stress-seed 7 or --stress-camera grazing.
+  bool pipelined = false;
+  bool allocStrict = false;
+  bool glCalls = false;
+  bool stateCache = true;
+  const char *shaderCacheDirectory = "shader_cache";
+  const char *textureCacheDirectory = "texture_cache";
+  long long traceFirstFrame = -1;
+  int traceFrameCount = 0;
+  StressSceneConfig sceneConfig;
+  std::string sceneName = "campfire";
+  bool stressScene = false;
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--pipelined"))
+      pipelined = true;
+    else if (!strcmp(argv[i], "--alloc-strict"))
+      allocStrict = true;
+    else if (!strcmp(argv[i], "--gl-calls"))
+      glCalls = true;
+    else if (!strcmp(argv[i], "--no-state-cache"))
+      stateCache = false;
+    else if (!strcmp(argv[i], "--shader-cache") && i + 1 < argc)
+      shaderCacheDirectory = argv[++i];
+    else if (!strcmp(argv[i], "--no-shader-cache"))
+      shaderCacheDirectory = nullptr;
+    else if (!strcmp(argv[i], "--texture-cache") && i + 1 < argc)
+      textureCacheDirectory = argv[++i];
+    else if (!strcmp(argv[i], "--no-texture-cache"))
+      textureCacheDirectory = nullptr;
+    else if (!strcmp(argv[i], "--trace") && i + 1 < argc)
+      tracePath = argv[++i];
+    else if (!strcmp(argv[i], "--trace-frames") && i + 2 < argc) {
+      traceFirstFrame = atoll(argv[++i]);
+      traceFrameCount = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--stress") && i + 1 < argc) {
+      sceneName = argv[++i];
+      stressScene = true;
+      if (!applyStressPreset(sceneName, sceneConfig)) {
+        std::cerr << "Unknown stress preset " << sceneName << ", one of:\n"
+                  << stressPresetsHelp();
+        return -1;
+      }
+    } else if (!strncmp(argv[i], "--stress-", 9) && i + 1 < argc) {
+      stressScene = true;
+      if (!setStressSceneValue(sceneConfig, argv[i] + 9, argv[i + 1]))
+        return -1;
+      ++i;
+    }
+  }
+
   glfwInit();
   glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
   glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
@@ -54,6 +146,15 @@ int main() {
     return -1;
   }
 
+  if (glCalls) {
+    if (glCallTracker::enabled)
+      glCallTracker::install();
+    else
+      std::cerr << "--gl-calls needs a build with GL_CALL_TRACKING=ON"
+                << std::endl;
+  }
+  glStateCache::setPassThrough(!stateCache);
+
   glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
 
   glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
@@ -70,125 +171,351 @@ int main() {
   std::cout << "Graphics Card Vendor: " << vendor << std::endl;
   std::cout << "Graphics Card Renderer: " << renderer << std::endl;
   std::cout << "OpenGL Version: " << version << std::endl;
+  std::cout << "CPU Kernel Tier: " << cpu::tierName(cpu::activeTier())
+            << " (detected " << cpu::tierName(cpu::detectTier()) << ")"
+            << std::endl;
 
-  glEnable(GL_DEPTH_TEST);
+  glStateCache::enable(GL_DEPTH_TEST);
   glDepthFunc(GL_LESS);
-  glEnable(GL_BLEND);
+  glStateCache::enable(GL_BLEND);
+
+  std::unique_ptr<ProgramCache> programCache;
+  if (shaderCacheDirectory)
+    programCache = std::make_unique<ProgramCache>(
+        shaderCacheDirectory,
+        vendorString + "\n" + rendererString + "\n" + versionString);
+
+  // Textures load on worker threads while the shaders compile.
+  const char *atlasPath = RESOURCES_PATH "fire.png";
+  TextureManager textures(textureCacheDirectory ? textureCacheDirectory : "");
+  textures.request(atlasPath, true);
+
+  auto shadersStart = std::chrono::steady_clock::now();
 
   // Floor shader
-  Shader shader(RESOURCES_PATH "particle.vert", RESOURCES_PATH "particle.frag");
+  Shader shader(RESOURCES_PATH "particle.vert", RESOURCES_PATH "particle.frag",
+                "", programCache.get());
   Shader particleShader(RESOURCES_PATH "system.vert",
-                        RESOURCES_PATH "system.frag");
+                        RESOURCES_PATH "system.frag", "", programCache.get());
+  Shader pulledParticleShader(RESOURCES_PATH "system.vert",
+                              RESOURCES_PATH "system.frag",
+                              "#define VERTEX_PULLING 1", programCache.get());
+  // Alpha-trimmed polygons instead of quads, see AtlasTrim
+  Shader trimmedParticleShader(RESOURCES_PATH "system.vert",
+                               RESOURCES_PATH "system.frag",
+                               "#define TRIMMED_QUADS 1\n"
+                               "#define TRIM_VERTICES 8",
+                               programCache.get());
+  Shader trimmedPulledParticleShader(RESOURCES_PATH "system.vert",
+                                     RESOURCES_PATH "system.frag",
+                                     "#define VERTEX_PULLING 1\n"
+                                     "#define TRIMMED_QUADS 1\n"
+                                     "#define TRIM_VERTICES 8",
+                                     programCache.get());
+  const int trimVertices = 8;
+  // [pulled][trimmed]
+  Shader *particlePrograms[2][2] = {
+      {&particleShader, &trimmedParticleShader},
+      {&pulledParticleShader, &trimmedPulledParticleShader}};
+
+  float shadersTime = std::chrono::duration<float>(
+                          std::chrono::steady_clock::now() - shadersStart)
+                          .count();
+  std::cout << "Shader Programs: " << shadersTime * 1000.0f << " ms";
+  if (programCache && programCache->isSupported()) {
+    const ProgramCache::Stats &cacheStats = programCache->getStats();
+    std::cout << " (cache: " << cacheStats.hits << " hits, "
+              << cacheStats.misses << " misses, " << cacheStats.rejected
+              << " rejected)";
+  } else {
+    std::cout << " (no cache)";
+  }
+  std::cout << std::endl;
+
+  // The floor is pre-transformed, see StaticBatch.
+  shader.use();
+  shader.setMat4("model", glm::mat4(1.0f));
+  shader.unuse();
+  for (Shader *program : {&particleShader, &pulledParticleShader,
+                          &trimmedParticleShader,
+                          &trimmedPulledParticleShader}) {
+    program->use();
+    program->setInt("atlasTexture", 0);
+    program->unuse();
+  }
+
+  // View, projection and camera vectors for every program, uploaded once per
+  // frame.
+  FrameUniformBuffer frameUniforms;
+
+  // Reduced resolution particle pass, scale picked in the debug window.
+  OffscreenParticles offscreenParticles(programCache.get());
+
+  const int atlasRows = 8;
+  auto texturesStart = std::chrono::steady_clock::now();
+  GLuint atlasTexture = textures.get(atlasPath);
+  float texturesWait = std::chrono::duration<float>(
+                           std::chrono::steady_clock::now() - texturesStart)
+                           .count();
+  const TextureManager::Stats &textureStats = textures.getStats();
+  std::cout << "Textures: waited " << texturesWait * 1000.0f << " ms, loaded "
+            << textureStats.uploaded << " in "
+            << textureStats.loadSeconds * 1000.0f << " ms on workers, upload "
+            << textureStats.uploadSeconds * 1000.0f << " ms, "
+            << textureStats.uploadedBytes / 1024 << " KiB "
+            << (textures.isCompressing() ? "BC3" : "RGBA8") << " (cache: "
+            << textureStats.cacheHits << " hits, " << textureStats.decoded
+            << " decoded)" << std::endl;
+
+  // Trim polygons from the atlas alpha; without them particles stay quads.
+  GLuint atlasTrimBuffer = 0;
+  if (const TextureManager::Pixels *pixels = textures.getPixels(atlasPath)) {
+    AtlasTrim trim = buildAtlasTrim(pixels->rgba.data(), pixels->width,
+                                    pixels->height, atlasRows, trimVertices);
+    textures.discardPixels(atlasPath);
+    atlasTrimBuffer = uploadAtlasTrim(trim);
+    std::cout << "Atlas Trim fire.png: " << atlasRows * atlasRows
+              << " frames, " << trimVertices << " vertices, fill area "
+              << trim.areaRatio * 100.0f << "% of a quad ("
+              << (1.0f - trim.areaRatio) * 100.0f << "% less)" << std::endl;
+  }
+
+  // The GUI and the pipeline drive the first emitter; the others of a
+  // stress scene are simulated inline and drawn after it.
+  sceneConfig.emitter.textureRows = atlasRows;
+  StressScene scene = generateStressScene(sceneConfig);
+  std::vector<std::unique_ptr<ParticleSystem>> emitters =
+      scene.createEmitters();
+  ParticleSystem &particleSystem = *emitters.front();
+  std::cout << "Scene: " << sceneName << ", seed " << sceneConfig.seed << ", "
+            << emitters.size() << " emitters, about "
+            << static_cast<long long>(scene.expectedParticles())
+            << " particles" << std::endl;
+
+  // Far enough to see the whole scene from its camera path.
+  float farPlane =
+      std::max(100.0f, glm::length(scene.boundsMax - scene.boundsMin) +
+                           2.0f * scene.cameraDistance + 50.0f);
+  if (stressScene) {
+    cameraOnScenePath = true;
+    camera.Position = scene.cameraPosition(0.0f);
+    camera.LookAt(scene.cameraTarget(0.0f));
+  }
 
-  GLuint atlasTexture = util::loadTexture(RESOURCES_PATH "fire.png");
+  ParticleRenderer particleRenderer;
 
-  ParticleSystem particleSystem(500.0f, // Particles per second
-                                5.0f,   // Average speed
-                                -1.5f,  // Gravity effect
-                                2.0f,   // Average life length
-                                2.0f);  // Average scale
+  ImGuiModule gui(window, particleSystem, particleRenderer);
 
-  particleSystem.setDirection(glm::vec3(0.0f, 1.0f, 0.0f), glm::radians(15.0f));
-  particleSystem.setSpeedError(0.2f);
-  particleSystem.setLifeError(0.2f);
-  particleSystem.setScaleError(0.5f);
-  particleSystem.randomizeRotation();
-  particleSystem.setTextureRows(8);
+  // GPU time per pass, read back a few frames late.
+  GpuProfiler gpuProfiler;
+  const int floorPass = gpuProfiler.addPass("Floor");
+  const int particlesPass = gpuProfiler.addPass("Particles");
+  const int guiPass = gpuProfiler.addPass("GUI");
+  gui.gpuProfiler = &gpuProfiler;
 
-  ImGuiModule gui(window, particleSystem);
+  std::unique_ptr<SimulationPipeline> pipeline;
+  if (pipelined)
+    pipeline = std::make_unique<SimulationPipeline>(particleSystem);
+  std::cout << "Simulation: " << (pipelined ? "pipelined" : "inline")
+            << std::endl;
 
-  // Floor
-  unsigned int VBO, VAO, EBO;
+  // Floor: a 30x30 grid of overlapping wireframe quads, one draw
+  StaticBatch floor;
   {
-    float floorVertices[] = {-3.0f, 0.0f, -3.0f, 3.0f,  0.0f, -3.0f,
-                             3.0f,  0.0f, 3.0f,  -3.0f, 0.0f, 3.0f};
-    unsigned int floorIndices[] = {0, 1, 2, 2, 3, 0};
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(floorVertices), floorVertices,
-                 GL_STATIC_DRAW);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(floorIndices), floorIndices,
-                 GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float),
-                          (void *)0);
-    glEnableVertexAttribArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    const glm::vec3 floorVertices[] = {{-3.0f, 0.0f, -3.0f},
+                                       {3.0f, 0.0f, -3.0f},
+                                       {3.0f, 0.0f, 3.0f},
+                                       {-3.0f, 0.0f, 3.0f}};
+    const unsigned int floorIndices[] = {0, 1, 2, 2, 3, 0};
+    for (int x = -15; x < 15; ++x)
+      for (int z = -15; z < 15; ++z)
+        floor.add(floorVertices, 4, floorIndices, 6,
+                  glm::translate(glm::mat4(1.0f), glm::vec3(x, 0.0f, z)));
+    floor.build();
   }
 
+  FrameArena::local().setName("main");
+  cpuProfiler::setThreadName("main");
+
+  if (traceFirstFrame >= 0) {
+    if (cpuProfiler::enabled)
+      cpuProfiler::requestCapture(traceFirstFrame, traceFrameCount, tracePath);
+    else
+      std::cerr << "--trace-frames needs a build with CPU_PROFILING=ON"
+                << std::endl;
+  }
+
+  if (allocStrict) {
+    if (allocTracker::enabled)
+      allocTracker::setStrict(true);
+    else
+      std::cerr << "--alloc-strict needs a build with ALLOC_TRACKING=ON"
+                << std::endl;
+  }
+  std::uint64_t paramsVersion = particleSystem.getParamsVersion();
+
   // Main loop
   while (!glfwWindowShouldClose(window)) {
     float currentFrame = glfwGetTime();
     deltaTime = currentFrame - lastFrame;
     lastFrame = currentFrame;
 
-    gui.beginFrame();
-    gui.frameTime = deltaTime;
-    gui.fps = 1.0f / deltaTime;
-
-    processInput(window);
-
-    particleSystem.update(deltaTime, camera.GetPosition());
-
-    glm::mat4 view = camera.GetViewMatrix();
-    glm::mat4 projection =
-        glm::perspective(glm::radians(camera.Zoom),
-                         (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-
-    glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    glDisable(GL_BLEND);
-    glBindVertexArray(VAO);
-    shader.use();
-    shader.setMat4("view", view);
-    shader.setMat4("projection", projection);
+    // Parameter edits resize particle storage; let them settle before strict
+    // mode holds the loop to zero allocations again.
+    if (particleSystem.getParamsVersion() != paramsVersion) {
+      paramsVersion = particleSystem.getParamsVersion();
+      allocTracker::restartWarmup();
+    }
 
-    glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+    {
+      ALLOC_SCOPE("input");
+      PROFILE_ZONE("input");
+      gui.beginFrame();
+      gui.frameTime = deltaTime;
+      gui.fps = 1.0f / deltaTime;
 
-    for (int x = -15; x < 15; ++x) {
-      for (int z = -15; z < 15; ++z) {
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(x, 0.0f, z));
-        shader.setMat4("model", model);
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-      }
+      processInput(window);
     }
 
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
-    glDepthMask(GL_FALSE);
+    const ParticleFrame *particleFrame = nullptr;
+    if (cameraOnScenePath) {
+      camera.Position = scene.cameraPosition(currentFrame);
+      camera.LookAt(scene.cameraTarget(currentFrame));
+    }
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, atlasTexture);
-    particleShader.use();
-    particleShader.setInt("atlasTexture", 0);
+    {
+      ALLOC_SCOPE("simulation");
+      PROFILE_ZONE("simulation");
+      if (pipeline) {
+        particleFrame = &pipeline->acquire();
+        pipeline->submit(deltaTime, camera.GetPosition());
+        gui.simulationTime = pipeline->getStepTime();
+      } else {
+        auto simulationStart = std::chrono::steady_clock::now();
+        particleSystem.update(deltaTime, camera.GetPosition());
+        gui.simulationTime = std::chrono::duration<float>(
+                                 std::chrono::steady_clock::now() -
+                                 simulationStart)
+                                 .count();
+      }
 
-    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+      // The rest of a stress scene, inline either way.
+      auto extraStart = std::chrono::steady_clock::now();
+      for (std::size_t i = 1; i < emitters.size(); ++i)
+        emitters[i]->update(deltaTime, camera.GetPosition());
+      if (emitters.size() > 1)
+        gui.simulationTime += std::chrono::duration<float>(
+                                  std::chrono::steady_clock::now() -
+                                  extraStart)
+                                  .count();
+    }
 
-    particleSystem.render(view, projection, particleShader);
+    {
+      ALLOC_SCOPE("render");
+      PROFILE_ZONE("render");
+      gpuProfiler.beginFrame();
+
+      FrameUniforms frameData;
+      frameData.view = camera.GetViewMatrix();
+      frameData.projection =
+          glm::perspective(glm::radians(camera.Zoom),
+                           (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f,
+                           farPlane);
+      frameData.cameraPosition = glm::vec4(camera.GetPosition(), 1.0f);
+      frameData.cameraRight = glm::vec4(camera.Right, 0.0f);
+      frameData.cameraUp = glm::vec4(camera.Up, 0.0f);
+      frameData.time = glm::vec4(currentFrame, deltaTime, 0.0f, 0.0f);
+      frameUniforms.update(frameData);
+
+      int framebufferWidth, framebufferHeight;
+      glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+      offscreenParticles.configure(framebufferWidth, framebufferHeight,
+                                   gui.particleResolutionDivisor);
+      bool offscreen = offscreenParticles.isActive();
+      if (offscreen)
+        offscreenParticles.beginScene();
+
+      gpuProfiler.begin(floorPass);
+      glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+      glStateCache::disable(GL_BLEND);
+      shader.use();
+      glStateCache::polygonMode(GL_LINE);
+      floor.draw();
+      gpuProfiler.end(floorPass);
+
+      gpuProfiler.begin(particlesPass);
+      if (offscreen)
+        offscreenParticles.beginParticles();
+
+      glStateCache::enable(GL_BLEND);
+      glStateCache::blendFunc(GL_SRC_ALPHA, GL_ONE);
+      glStateCache::depthMask(GL_FALSE);
+
+      glStateCache::activeTexture(GL_TEXTURE0);
+      glStateCache::bindTexture(GL_TEXTURE_2D, atlasTexture);
+
+      glStateCache::polygonMode(GL_FILL);
+
+      particleRenderer.setTrimVertices(
+          atlasTrimBuffer && gui.trimmedQuads ? trimVertices : 0);
+      Shader &program =
+          *particlePrograms[particleRenderer.getRenderPath() ==
+                            ParticleRenderPath::Pulled]
+                           [particleRenderer.getTrimVertices() != 0];
+      particleRenderer.beginFrame();
+      if (particleFrame)
+        particleRenderer.render(*particleFrame, program);
+      else
+        particleRenderer.render(particleSystem, program);
+      for (std::size_t i = 1; i < emitters.size(); ++i)
+        particleRenderer.render(*emitters[i], program);
+      particleRenderer.endFrame();
+
+      if (offscreen)
+        offscreenParticles.composite();
+      gpuProfiler.end(particlesPass);
+
+      glStateCache::depthMask(GL_TRUE);
+      glStateCache::blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+      glStateCache::disable(GL_BLEND);
+    }
 
-    glDepthMask(GL_TRUE);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glDisable(GL_BLEND);
+    {
+      ALLOC_SCOPE("gui");
+      PROFILE_ZONE("gui");
+      gpuProfiler.begin(guiPass);
+      gui.render();
+      gpuProfiler.end(guiPass);
+    }
 
-    gui.render();
+    {
+      ALLOC_SCOPE("present");
+      PROFILE_ZONE("present");
+      glfwSwapBuffers(window);
+      glfwPollEvents();
 
-    glfwSwapBuffers(window);
-    glfwPollEvents();
+      gui.endFrame();
+    }
 
-    gui.endFrame();
+    FrameArena::local().reset();
+    allocTracker::endFrame();
+    glCallTracker::endFrame();
+    glStateCache::endFrame();
+    cpuProfiler::endFrame();
   }
 
   // Cleanup
+  pipeline.reset();
   gui.cleanup();
-  glDeleteVertexArrays(1, &VAO);
-  glDeleteBuffers(1, &VBO);
-  glDeleteBuffers(1, &EBO);
+  floor.release();
+  particleRenderer.release();
+  offscreenParticles.release();
+  textures.release();
+  gpuProfiler.release();
+  if (atlasTrimBuffer)
+    glDeleteBuffers(1, &atlasTrimBuffer);
 
   glfwTerminate();
   return 0;
@@ -216,6 +543,8 @@ void mouse_callback(GLFWwindow *window, double xpos, double ypos) {
   float yoffset = lastY - ypos;
   lastX = xpos;
   lastY = ypos;
+  if (xoffset != 0.0f || yoffset != 0.0f)
+    cameraOnScenePath = false;
 
   camera.ProcessMouseMovement(xoffset, yoffset);
 }
@@ -226,9 +555,23 @@ void scroll_callback(GLFWwindow *window, double xoffset, double yoffset) {
 
 void processInput(GLFWwindow *window) {
   static bool tabKeyPressed = false;
+  static bool traceKeyPressed = false;
   if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
     glfwSetWindowShouldClose(window, true);
 
+  if (glfwGetKey(window, GLFW_KEY_F9) == GLFW_PRESS) {
+    if (!traceKeyPressed && cpuProfiler::enabled &&
+        !cpuProfiler::isCapturing()) {
+      cpuProfiler::requestCapture(cpuProfiler::frameIndex() + 1,
+                                  traceHotkeyFrames, tracePath);
+      std::cout << "Trace: capturing " << traceHotkeyFrames << " frames"
+                << std::endl;
+    }
+    traceKeyPressed = true;
+  } else {
+    traceKeyPressed = false;
+  }
+
   if (glfwGetKey(window, GLFW_KEY_TAB) == GLFW_PRESS) {
     if (!tabKeyPressed) {
       tabKeyPressed = true;
@@ -243,6 +586,9 @@ void processInput(GLFWwindow *window) {
   }
 
   if (isMouseCaptured) {
+    for (int key : {GLFW_KEY_W, GLFW_KEY_S, GLFW_KEY_A, GLFW_KEY_D})
+      if (glfwGetKey(window, key) == GLFW_PRESS)
+        cameraOnScenePath = false;
     if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
       camera.ProcessKeyboard(FORWARD, deltaTime);
     if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
@@ -266,7 +612,7 @@ void renderQuad() {
     };
     glGenVertexArrays(1, &quadVAO);
     glGenBuffers(1, &quadVBO);
-    glBindVertexArray(quadVAO);
+    glStateCache::bindVertexArray(quadVAO);
     glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices,
                  GL_STATIC_DRAW);
@@ -278,7 +624,7 @@ void renderQuad() {
                           (void *)(2 * sizeof(float)));
   }
 
-  glBindVertexArray(quadVAO);
+  glStateCache::bindVertexArray(quadVAO);
   glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-  glBindVertexArray(0);
+  glStateCache::bindVertexArray(0);
 }
@@ -0,0 +1,189 @@
+#include "offscreen_particles.hpp"
+
+#include "gl_state_cache.hpp"
+
+#include <iostream>
+
+namespace {
+
+GLuint createTexture(GLenum internalFormat, int width, int height,
+                     GLenum filter) {
+  GLuint texture;
+  glGenTextures(1, &texture);
+  glStateCache::bindTexture(GL_TEXTURE_2D, texture);
+  glTexStorage2D(GL_TEXTURE_2D, 1, internalFormat, width, height);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glStateCache::bindTexture(GL_TEXTURE_2D, 0);
+  return texture;
+}
+
+void checkFramebuffer(const char *name) {
+  GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  if (status != GL_FRAMEBUFFER_COMPLETE)
+    std::cerr << "Offscreen particles: " << name
+              << " framebuffer incomplete (0x" << std::hex << status
+              << std::dec << ")" << std::endl;
+}
+
+} // namespace
+
+OffscreenParticles::OffscreenParticles(ProgramCache *cache)
+    : downsampleShader(RESOURCES_PATH "fullscreen.vert",
+                       RESOURCES_PATH "depth_downsample.frag", "", cache),
+      compositeShader(RESOURCES_PATH "fullscreen.vert",
+                      RESOURCES_PATH "particle_composite.frag", "", cache) {
+  divisorLocation = downsampleShader.getUniformLocation("divisor");
+
+  downsampleShader.use();
+  downsampleShader.setInt("sceneDepth", 0);
+  compositeShader.use();
+  compositeShader.setInt("sceneDepth", 0);
+  compositeShader.setInt("particleDepth", 1);
+  compositeShader.setInt("particleColor", 2);
+  compositeShader.setFloat("depthThreshold", 0.05f);
+  compositeShader.unuse();
+
+  glGenVertexArrays(1, &emptyVAO);
+}
+
+void OffscreenParticles::configure(int newWidth, int newHeight,
+                                   int newDivisor) {
+  if (newDivisor != 2 && newDivisor != 4)
+    newDivisor = 1;
+  if (newWidth == width && newHeight == height && newDivisor == divisor)
+    return;
+
+  width = newWidth;
+  height = newHeight;
+  divisor = newDivisor;
+  releaseTargets();
+  if (isActive())
+    createTargets();
+}
+
+bool OffscreenParticles::isActive() const {
+  return divisor > 1 && width > 0 && height > 0;
+}
+
+int OffscreenParticles::getDivisor() const { return divisor; }
+
+void OffscreenParticles::createTargets() {
+  particleWidth = (width + divisor - 1) / divisor;
+  particleHeight = (height + divisor - 1) / divisor;
+
+  glGenRenderbuffers(1, &sceneColor);
+  glBindRenderbuffer(GL_RENDERBUFFER, sceneColor);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+  sceneDepth = createTexture(GL_DEPTH_COMPONENT24, width, height, GL_NEAREST);
+
+  glGenFramebuffers(1, &sceneFBO);
+  glBindFramebuffer(GL_FRAMEBUFFER, sceneFBO);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                            GL_RENDERBUFFER, sceneColor);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D,
+                         sceneDepth, 0);
+  checkFramebuffer("scene");
+
+  // Float color so many additive layers accumulate without clamping until
+  // the composite.
+  particleColor = createTexture(GL_RGBA16F, particleWidth, particleHeight,
+                                GL_LINEAR);
+  particleDepth = createTexture(GL_DEPTH_COMPONENT24, particleWidth,
+                                particleHeight, GL_NEAREST);
+
+  glGenFramebuffers(1, &particleFBO);
+  glBindFramebuffer(GL_FRAMEBUFFER, particleFBO);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                         particleColor, 0);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D,
+                         particleDepth, 0);
+  checkFramebuffer("particle");
+
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void OffscreenParticles::beginScene() {
+  glBindFramebuffer(GL_FRAMEBUFFER, sceneFBO);
+  glViewport(0, 0, width, height);
+}
+
+void OffscreenParticles::beginParticles() {
+  glBindFramebuffer(GL_FRAMEBUFFER, particleFBO);
+  glViewport(0, 0, particleWidth, particleHeight);
+  glStateCache::polygonMode(GL_FILL);
+
+  // Depth only: every texel gets the farthest scene depth of its block.
+  glStateCache::disable(GL_BLEND);
+  glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+  glStateCache::depthMask(GL_TRUE);
+  glDepthFunc(GL_ALWAYS);
+
+  glStateCache::activeTexture(GL_TEXTURE0);
+  glStateCache::bindTexture(GL_TEXTURE_2D, sceneDepth);
+  downsampleShader.use();
+  downsampleShader.setInt(divisorLocation, divisor);
+  glStateCache::bindVertexArray(emptyVAO);
+  glDrawArrays(GL_TRIANGLES, 0, 3);
+  glStateCache::bindVertexArray(0);
+  downsampleShader.unuse();
+
+  glDepthFunc(GL_LESS);
+  glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+  glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+  glClear(GL_COLOR_BUFFER_BIT);
+}
+
+void OffscreenParticles::composite() {
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, sceneFBO);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+  glBlitFramebuffer(0, 0, width, height, 0, 0, width, height,
+                    GL_COLOR_BUFFER_BIT, GL_NEAREST);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glViewport(0, 0, width, height);
+
+  glStateCache::disable(GL_DEPTH_TEST);
+  glStateCache::enable(GL_BLEND);
+  glStateCache::blendFunc(GL_ONE, GL_ONE);
+
+  glStateCache::activeTexture(GL_TEXTURE0);
+  glStateCache::bindTexture(GL_TEXTURE_2D, sceneDepth);
+  glStateCache::activeTexture(GL_TEXTURE1);
+  glStateCache::bindTexture(GL_TEXTURE_2D, particleDepth);
+  glStateCache::activeTexture(GL_TEXTURE2);
+  glStateCache::bindTexture(GL_TEXTURE_2D, particleColor);
+
+  compositeShader.use();
+  glStateCache::bindVertexArray(emptyVAO);
+  glDrawArrays(GL_TRIANGLES, 0, 3);
+  glStateCache::bindVertexArray(0);
+  compositeShader.unuse();
+
+  glStateCache::activeTexture(GL_TEXTURE2);
+  glStateCache::bindTexture(GL_TEXTURE_2D, 0);
+  glStateCache::activeTexture(GL_TEXTURE1);
+  glStateCache::bindTexture(GL_TEXTURE_2D, 0);
+  glStateCache::activeTexture(GL_TEXTURE0);
+  glStateCache::bindTexture(GL_TEXTURE_2D, 0);
+  glStateCache::enable(GL_DEPTH_TEST);
+}
+
+void OffscreenParticles::release() {
+  releaseTargets();
+  glStateCache::deleteVertexArrays(1, &emptyVAO);
+  emptyVAO = 0;
+}
+
+void OffscreenParticles::releaseTargets() {
+  glDeleteFramebuffers(1, &sceneFBO);
+  glDeleteFramebuffers(1, &particleFBO);
+  glDeleteRenderbuffers(1, &sceneColor);
+  glStateCache::deleteTextures(1, &sceneDepth);
+  glStateCache::deleteTextures(1, &particleColor);
+  glStateCache::deleteTextures(1, &particleDepth);
+  sceneFBO = particleFBO = sceneColor = 0;
+  sceneDepth = particleColor = particleDepth = 0;
+}
@@ -0,0 +1,64 @@
+#ifndef OFFSCREEN_PARTICLES_HPP
+#define OFFSCREEN_PARTICLES_HPP
+
+#include "shader.hpp"
+#include <glad/glad.h>
+
+class ProgramCache;
+
+// Renders particles at 1/2 or 1/4 of the framebuffer resolution to cut the
+// fill cost of large overlapping additive quads. The opaque scene goes into
+// a full resolution target whose depth is downsampled (farthest of each
+// block) for particle occlusion; the particle color is then added back over
+// the scene with a nearest-depth upsample so it does not bleed across
+// geometry edges.
+//
+// Per frame, when isActive(): beginScene(), draw opaque geometry,
+// beginParticles(), draw particles with additive blending, composite().
+class OffscreenParticles {
+public:
+  explicit OffscreenParticles(ProgramCache *cache = nullptr);
+
+  OffscreenParticles(const OffscreenParticles &) = delete;
+  OffscreenParticles &operator=(const OffscreenParticles &) = delete;
+
+  // Output size and resolution divisor (1, 2 or 4; 1 disables the pass).
+  // Targets are only rebuilt when something changed.
+  void configure(int width, int height, int divisor);
+  bool isActive() const;
+  int getDivisor() const;
+
+  void beginScene();
+  // Leaves the particle target bound with the downsampled depth attached,
+  // depth test LESS, depth writes on and blending off.
+  void beginParticles();
+  // Copies the scene to the default framebuffer and adds the particles,
+  // leaving depth test enabled and the default framebuffer bound.
+  void composite();
+
+  void release();
+
+private:
+  void createTargets();
+  void releaseTargets();
+
+  Shader downsampleShader;
+  Shader compositeShader;
+  GLint divisorLocation;
+
+  int width = 0;
+  int height = 0;
+  int divisor = 1;
+  int particleWidth = 0;
+  int particleHeight = 0;
+
+  GLuint emptyVAO = 0;
+  GLuint sceneFBO = 0;
+  GLuint sceneColor = 0;
+  GLuint sceneDepth = 0;
+  GLuint particleFBO = 0;
+  GLuint particleColor = 0;
+  GLuint particleDepth = 0;
+};
+
+#endif // OFFSCREEN_PARTICLES_HPP
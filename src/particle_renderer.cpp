@@ -0,0 +1,262 @@
+#include "particle_renderer.hpp"
+
+#include "cpu_profiler.hpp"
+#include "gl_state_cache.hpp"
+#include "particle_system.hpp"
+#include "shader.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Storage buffer binding of the packed records in system.vert.
+const GLuint pulledInstancesBinding = 1;
+
+std::size_t storageOffsetAlignment() {
+  GLint alignment = 0;
+  glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+  // Both are powers of two, so the larger is a multiple of the record size.
+  return std::max<std::size_t>(sizeof(PackedParticleInstance),
+                               alignment > 0 ? alignment : 256);
+}
+
+} // namespace
+
+ParticleRenderer::ParticleRenderer()
+    : instanceStream(GL_ARRAY_BUFFER, 1000 * sizeof(ParticleInstance),
+                     sizeof(ParticleInstance)),
+      packedStream(GL_SHADER_STORAGE_BUFFER,
+                   1000 * sizeof(PackedParticleInstance),
+                   storageOffsetAlignment()) {
+  float quadVertices[] = {
+      -0.5f, -0.5f, 0.0f, 0.0f, 0.0f, // Bottom-left
+      0.5f,  -0.5f, 0.0f, 1.0f, 0.0f, // Bottom-right
+      -0.5f, 0.5f,  0.0f, 0.0f, 1.0f, // Top-left
+      0.5f,  0.5f,  0.0f, 1.0f, 1.0f  // Top-right
+  };
+
+  glGenVertexArrays(1, &quadVAO);
+  glGenBuffers(1, &quadVBO);
+
+  glStateCache::bindVertexArray(quadVAO);
+
+  glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), quadVertices,
+               GL_STATIC_DRAW);
+
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *)0);
+
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float),
+                        (void *)(3 * sizeof(float)));
+
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glStateCache::bindVertexArray(0);
+
+  bindInstanceAttributes();
+
+  // Core profile needs some VAO bound even when nothing is fetched.
+  glGenVertexArrays(1, &pulledVAO);
+}
+
+void ParticleRenderer::beginFrame() {
+  instanceStream.beginFrame();
+  packedStream.beginFrame();
+}
+
+void ParticleRenderer::endFrame() {
+  flushInstances();
+  instanceStream.endFrame();
+  packedStream.endFrame();
+}
+
+void ParticleRenderer::render(const ParticleSystem &system, Shader &shader) {
+  PROFILE_ZONE("ParticleRenderer::render");
+  if (renderPath == ParticleRenderPath::Pulled) {
+    auto *records = static_cast<PackedParticleInstance *>(packedStream.map(
+        system.getSlotCount() * sizeof(PackedParticleInstance)));
+    std::size_t count = system.writePackedInstances(records);
+    packedStream.unmap(count * sizeof(PackedParticleInstance));
+    drawPulled(count, system.getParams().textureRows,
+               system.getEmitterPosition(), shader);
+    return;
+  }
+
+  // Inline simulation: build the instances directly in the mapped region.
+  // Growing the stream replaces the buffer the batch reads from.
+  std::size_t bytes = system.getSlotCount() * sizeof(ParticleInstance);
+  if (!instanceStream.fits(bytes))
+    flushInstances();
+  void *region = instanceStream.map(bytes);
+  std::size_t count =
+      system.writeInstances(static_cast<ParticleInstance *>(region));
+  instanceStream.unmap(count * sizeof(ParticleInstance));
+  queueInstances(count, system.getParams().textureRows, shader);
+}
+
+void ParticleRenderer::render(const ParticleFrame &frame, Shader &shader) {
+  PROFILE_ZONE("ParticleRenderer::render");
+  if (renderPath == ParticleRenderPath::Pulled) {
+    std::size_t bytes =
+        frame.instances.size() * sizeof(PackedParticleInstance);
+    auto *records =
+        static_cast<PackedParticleInstance *>(packedStream.map(bytes));
+    for (std::size_t i = 0; i < frame.instances.size(); ++i)
+      records[i] = packInstance(frame.instances[i], frame.origin);
+    packedStream.unmap(bytes);
+    drawPulled(frame.instances.size(), frame.textureRows, frame.origin,
+               shader);
+    return;
+  }
+
+  std::size_t bytes = frame.instances.size() * sizeof(ParticleInstance);
+  if (!instanceStream.fits(bytes))
+    flushInstances();
+  void *region = instanceStream.map(bytes);
+  if (bytes)
+    std::memcpy(region, frame.instances.data(), bytes);
+  instanceStream.unmap(bytes);
+  queueInstances(frame.instances.size(), frame.textureRows, shader);
+}
+
+void ParticleRenderer::bindInstanceAttributes() {
+  // Per-instance attributes: position, (scale, rotation, blend, life) and the
+  // two flipbook indices.
+  instanceAttributesBuffer = instanceStream.getBuffer();
+  glStateCache::bindVertexArray(quadVAO);
+  glBindBuffer(GL_ARRAY_BUFFER, instanceAttributesBuffer);
+
+  glEnableVertexAttribArray(2);
+  glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(ParticleInstance),
+                        (void *)offsetof(ParticleInstance, position));
+  glVertexAttribDivisor(2, 1);
+
+  glEnableVertexAttribArray(3);
+  glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(ParticleInstance),
+                        (void *)offsetof(ParticleInstance, scale));
+  glVertexAttribDivisor(3, 1);
+
+  glEnableVertexAttribArray(4);
+  glVertexAttribIPointer(4, 2, GL_UNSIGNED_INT, sizeof(ParticleInstance),
+                         (void *)offsetof(ParticleInstance,
+                                          currentTextureIndex));
+  glVertexAttribDivisor(4, 1);
+
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glStateCache::bindVertexArray(0);
+}
+
+void ParticleRenderer::queueInstances(std::size_t count,
+                                      unsigned int textureRows,
+                                      Shader &shader) {
+  if (!count)
+    return;
+  GLuint first = static_cast<GLuint>(instanceStream.getOffset() /
+                                     sizeof(ParticleInstance));
+  if (pendingCount &&
+      (pendingShader != &shader || pendingTextureRows != textureRows ||
+       pendingFirst + pendingCount != first))
+    flushInstances();
+  if (!pendingCount) {
+    pendingShader = &shader;
+    pendingTextureRows = textureRows;
+    pendingFirst = first;
+  }
+  pendingCount += count;
+}
+
+void ParticleRenderer::flushInstances() {
+  if (!pendingCount)
+    return;
+  drawInstances(pendingFirst, pendingCount, pendingTextureRows,
+                *pendingShader);
+  pendingCount = 0;
+}
+
+void ParticleRenderer::drawInstances(GLuint baseInstance, std::size_t count,
+                                     unsigned int textureRows,
+                                     Shader &shader) {
+  updateUniformLocations(shader);
+
+  shader.use();
+  shader.setInt(textureRowsLocation, textureRows);
+
+  // The stream reallocates when it grows.
+  if (instanceStream.getBuffer() != instanceAttributesBuffer)
+    bindInstanceAttributes();
+
+  glStateCache::bindVertexArray(quadVAO);
+  glDrawArraysInstancedBaseInstance(particlePrimitive(), 0,
+                                    particleVertexCount(),
+                                    static_cast<GLsizei>(count), baseInstance);
+  // The program and VAO stay bound, so the state cache drops the binds of
+  // the next emitter drawn the same way.
+}
+
+void ParticleRenderer::drawPulled(std::size_t count, unsigned int textureRows,
+                                  const glm::vec3 &origin, Shader &shader) {
+  updateUniformLocations(shader);
+
+  shader.use();
+  shader.setInt(textureRowsLocation, textureRows);
+  shader.setVec3(instanceOriginLocation, origin);
+
+  if (count > 0) {
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, pulledInstancesBinding,
+                      packedStream.getBuffer(),
+                      static_cast<GLintptr>(packedStream.getOffset()),
+                      count * sizeof(PackedParticleInstance));
+    glStateCache::bindVertexArray(pulledVAO);
+    glDrawArraysInstanced(particlePrimitive(), 0, particleVertexCount(),
+                          static_cast<GLsizei>(count));
+  }
+}
+
+void ParticleRenderer::updateUniformLocations(const Shader &shader) {
+  if (shader.ID == uniformsProgram)
+    return;
+  uniformsProgram = shader.ID;
+  textureRowsLocation = shader.getUniformLocation("textureRows");
+  instanceOriginLocation = shader.getUniformLocation("instanceOrigin");
+}
+
+void ParticleRenderer::setRenderPath(ParticleRenderPath path) {
+  flushInstances();
+  renderPath = path;
+}
+
+ParticleRenderPath ParticleRenderer::getRenderPath() const {
+  return renderPath;
+}
+
+void ParticleRenderer::setTrimVertices(int vertices) {
+  // The batch was gathered for the current primitive.
+  flushInstances();
+  trimVertices = vertices >= 3 ? vertices : 0;
+}
+
+int ParticleRenderer::getTrimVertices() const { return trimVertices; }
+
+GLenum ParticleRenderer::particlePrimitive() const {
+  return trimVertices ? GL_TRIANGLES : GL_TRIANGLE_STRIP;
+}
+
+GLsizei ParticleRenderer::particleVertexCount() const {
+  return trimVertices ? (trimVertices - 2) * 3 : 4;
+}
+
+const StreamBuffer::Stats &ParticleRenderer::getInstanceStreamStats() const {
+  return renderPath == ParticleRenderPath::Pulled ? packedStream.getStats()
+                                                  : instanceStream.getStats();
+}
+
+void ParticleRenderer::release() {
+  instanceStream.release();
+  packedStream.release();
+  glStateCache::deleteVertexArrays(1, &quadVAO);
+  glDeleteBuffers(1, &quadVBO);
+  glStateCache::deleteVertexArrays(1, &pulledVAO);
+  quadVAO = quadVBO = pulledVAO = 0;
+}
@@ -0,0 +1,102 @@
+#ifndef PARTICLE_RENDERER_HPP
+#define PARTICLE_RENDERER_HPP
+
+#include "particle_frame.hpp"
+#include "stream_buffer.hpp"
+
+#include <glad/glad.h>
+#include <cstddef>
+
+class ParticleSystem;
+class Shader;
+
+// Attributes feeds system.vert one ParticleInstance per instance through
+// vertex attributes. Pulled builds the quad from gl_VertexID and reads a
+// PackedParticleInstance from a storage buffer; it needs the program built
+// with VERTEX_PULLING defined.
+enum class ParticleRenderPath { Attributes, Pulled };
+
+// Draws the output of a ParticleSystem. All GL state for particles lives
+// here; the simulation itself is in particle_core and never touches GL.
+// Render thread only.
+class ParticleRenderer {
+public:
+  // Needs the GL context current.
+  ParticleRenderer();
+  ParticleRenderer(const ParticleRenderer &) = delete;
+  ParticleRenderer &operator=(const ParticleRenderer &) = delete;
+
+  // Bracket every render() of a frame. All emitters share one region of the
+  // instance stream, so the GPU is waited on at most once per frame. On the
+  // attribute path consecutive emitters drawn with the same program and
+  // flipbook size become one draw, issued when the next emitter does not
+  // match or at endFrame(). The pulled path draws each emitter right away,
+  // as its records are relative to the emitter's origin.
+  void beginFrame();
+  void endFrame();
+
+  // Builds the instances of the last update() of system straight into the
+  // mapped stream; for inline simulation on this thread.
+  void render(const ParticleSystem &system, Shader &shader);
+  // Draws a frame written by ParticleSystem::writeFrame(). Only touches GL
+  // state, so it may run while another thread is inside update().
+  // View and projection come from the FrameData uniform block.
+  void render(const ParticleFrame &frame, Shader &shader);
+
+  void setRenderPath(ParticleRenderPath path);
+  ParticleRenderPath getRenderPath() const;
+  // Draw each particle as a convex polygon of this many vertices instead of
+  // a quad (0). Needs the program built with TRIMMED_QUADS and a matching
+  // TRIM_VERTICES, and the AtlasTrim buffer bound.
+  void setTrimVertices(int vertices);
+  int getTrimVertices() const;
+
+  // Stream of the active render path.
+  const StreamBuffer::Stats &getInstanceStreamStats() const;
+
+  void release();
+
+private:
+  void bindInstanceAttributes();
+  // Adds the instances of the last instanceStream map() to the batch.
+  void queueInstances(std::size_t count, unsigned int textureRows,
+                      Shader &shader);
+  void flushInstances();
+  void drawInstances(GLuint baseInstance, std::size_t count,
+                     unsigned int textureRows, Shader &shader);
+  void drawPulled(std::size_t count, unsigned int textureRows,
+                  const glm::vec3 &origin, Shader &shader);
+  void updateUniformLocations(const Shader &shader);
+  // Primitive and vertex count of one particle for the current trim mode.
+  GLenum particlePrimitive() const;
+  GLsizei particleVertexCount() const;
+
+  GLuint quadVAO = 0;
+  GLuint quadVBO = 0;
+  // One ParticleInstance per live particle, read with divisor 1. Regions are
+  // instance aligned and selected with the draw's base instance.
+  StreamBuffer instanceStream;
+  GLuint instanceAttributesBuffer = 0;
+  // Draw being gathered: pendingCount instances from pendingFirst on.
+  Shader *pendingShader = nullptr;
+  unsigned int pendingTextureRows = 0;
+  GLuint pendingFirst = 0;
+  std::size_t pendingCount = 0;
+
+  // Pulled path: packed records drawn with an attribute-less VAO. Every
+  // emitter of a frame writes its records behind the previous one's in the
+  // frame's region and binds just its own range, so the region is fenced
+  // once per frame however many emitters there are. Pieces start at the
+  // storage buffer offset alignment.
+  ParticleRenderPath renderPath = ParticleRenderPath::Attributes;
+  int trimVertices = 0;
+  StreamBuffer packedStream;
+  GLuint pulledVAO = 0;
+
+  // Uniform locations, looked up again when a different program is passed.
+  GLuint uniformsProgram = 0;
+  GLint textureRowsLocation = -1;
+  GLint instanceOriginLocation = -1;
+};
+
+#endif // PARTICLE_RENDERER_HPP
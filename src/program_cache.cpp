@@ -0,0 +1,146 @@
+#include "program_cache.hpp"
+
+#include "disk_cache.hpp"
+#include "gl_state_cache.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+// Entry layout: header, then length bytes of binary.
+struct EntryHeader {
+  char magic[4];
+  std::uint32_t version;
+  std::uint64_t key;
+  std::uint32_t format;
+  std::uint32_t length;
+};
+
+const char entryMagic[4] = {'P', 'B', 'I', 'N'};
+const std::uint32_t entryVersion = 1;
+
+} // namespace
+
+ProgramCache::ProgramCache(const std::string &directory,
+                           const std::string &driverId)
+    : directory(directory),
+      driverHash(diskCache::hash(driverId.c_str(), driverId.size())),
+      supported(false) {
+  GLint formats = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+  if (formats <= 0) {
+    std::cout << "Program cache: driver exposes no binary formats" << std::endl;
+    return;
+  }
+
+  std::error_code error;
+  std::filesystem::create_directories(directory, error);
+  if (error) {
+    std::cerr << "Program cache: cannot create " << directory << ": "
+              << error.message() << std::endl;
+    return;
+  }
+  supported = true;
+}
+
+bool ProgramCache::isSupported() const { return supported; }
+
+std::uint64_t ProgramCache::key(const std::string &vertexSource,
+                                const std::string &fragmentSource,
+                                const char *defines) const {
+  std::uint64_t value = diskCache::hash(vertexSource, driverHash);
+  value = diskCache::hash(fragmentSource, value);
+  return diskCache::hash(std::string(defines ? defines : ""), value);
+}
+
+std::string ProgramCache::entryPath(std::uint64_t key) const {
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx.bin",
+                static_cast<unsigned long long>(key));
+  return (std::filesystem::path(directory) / name).string();
+}
+
+GLuint ProgramCache::load(std::uint64_t key) {
+  std::string path = entryPath(key);
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    ++stats.misses;
+    return 0;
+  }
+
+  EntryHeader header;
+  std::vector<char> binary;
+  bool valid = false;
+  if (file.read(reinterpret_cast<char *>(&header), sizeof(header)) &&
+      std::equal(entryMagic, entryMagic + 4, header.magic) &&
+      header.version == entryVersion && header.key == key) {
+    binary.resize(header.length);
+    valid = static_cast<bool>(file.read(binary.data(), header.length));
+  }
+  file.close();
+
+  GLuint program = 0;
+  if (valid) {
+    program = glCreateProgram();
+    glProgramBinary(program, header.format, binary.data(),
+                    static_cast<GLsizei>(binary.size()));
+    GLint linked = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+      glStateCache::deleteProgram(program);
+      program = 0;
+    }
+  }
+
+  if (!program) {
+    ++stats.rejected;
+    ++stats.misses;
+    std::error_code error;
+    std::filesystem::remove(path, error);
+    return 0;
+  }
+
+  ++stats.hits;
+  return program;
+}
+
+void ProgramCache::store(std::uint64_t key, GLuint program) {
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0)
+    return;
+
+  std::vector<char> binary(length);
+  GLenum format = 0;
+  GLsizei written = 0;
+  glGetProgramBinary(program, length, &written, &format, binary.data());
+  if (written <= 0)
+    return;
+
+  EntryHeader header;
+  std::copy(entryMagic, entryMagic + 4, header.magic);
+  header.version = entryVersion;
+  header.key = key;
+  header.format = format;
+  header.length = static_cast<std::uint32_t>(written);
+
+  bool stored = diskCache::writeAtomically(
+      entryPath(key), [&](const std::string &temporary) {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(binary.data(), header.length);
+        if (!file)
+          std::cerr << "Program cache: cannot write " << temporary
+                    << std::endl;
+        return static_cast<bool>(file);
+      });
+  if (stored)
+    ++stats.stored;
+}
+
+const ProgramCache::Stats &ProgramCache::getStats() const { return stats; }
@@ -0,0 +1,50 @@
+#ifndef PROGRAM_CACHE_HPP
+#define PROGRAM_CACHE_HPP
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <string>
+
+// On-disk cache of linked program binaries (glGetProgramBinary). Entries are
+// keyed by a hash of the final stage sources, the defines and a driver id,
+// so editing a shader or updating the driver simply misses and recompiles.
+// An entry the driver refuses to load is deleted and rebuilt.
+class ProgramCache {
+public:
+  struct Stats {
+    unsigned int hits = 0;
+    unsigned int misses = 0;
+    // Entries that were found but unusable (corrupt, or rejected by the
+    // driver), counted as misses as well.
+    unsigned int rejected = 0;
+    unsigned int stored = 0;
+  };
+
+  // driverId should identify the GL implementation, e.g. vendor, renderer
+  // and version string joined.
+  ProgramCache(const std::string &directory, const std::string &driverId);
+
+  // False when the driver offers no binary formats; the cache then does
+  // nothing and every program compiles.
+  bool isSupported() const;
+
+  std::uint64_t key(const std::string &vertexSource,
+                    const std::string &fragmentSource,
+                    const char *defines) const;
+
+  // Linked program for key, or 0 on a miss.
+  GLuint load(std::uint64_t key);
+  void store(std::uint64_t key, GLuint program);
+
+  const Stats &getStats() const;
+
+private:
+  std::string entryPath(std::uint64_t key) const;
+
+  std::string directory;
+  std::uint64_t driverHash;
+  bool supported;
+  Stats stats;
+};
+
+#endif // PROGRAM_CACHE_HPP
@@ -6,13 +6,36 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
 #include <glm/glm.hpp>
 
+#include "gl_state_cache.hpp"
+#include "program_cache.hpp"
+
 class Shader {
 public:
     unsigned int ID;
 
-    Shader(const char* vertexPath, const char* fragmentPath) {
+    // Active uniforms and uniform blocks, reflected once after linking.
+    // Array uniforms are listed by their base name ("foo", not "foo[0]").
+    struct Uniform {
+        std::string name;
+        GLint location;
+        GLenum type;
+        GLint size;
+    };
+
+    struct UniformBlock {
+        std::string name;
+        GLuint index;
+        GLint binding;
+        GLint dataSize;
+    };
+
+    // defines is pasted after the #version line of both stages, one
+    // "#define NAME VALUE" per line. With a cache the linked program is
+    // loaded from / saved to disk instead of compiled on every launch.
+    Shader(const char* vertexPath, const char* fragmentPath, const char* defines = "", ProgramCache* cache = nullptr) {
         std::string vertexCode;
         std::string fragmentCode;
         std::ifstream vShaderFile;
@@ -38,6 +61,21 @@ public:
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ" << std::endl;
         }
 
+        injectDefines(vertexCode, defines);
+        injectDefines(fragmentCode, defines);
+
+        std::uint64_t cacheKey = 0;
+        if (cache && cache->isSupported()) {
+            cacheKey = cache->key(vertexCode, fragmentCode, defines);
+            ID = cache->load(cacheKey);
+            if (ID) {
+                reflect();
+                return;
+            }
+        } else {
+            cache = nullptr;
+        }
+
         const char* vShaderCode = vertexCode.c_str();
         const char* fShaderCode = fragmentCode.c_str();
 
@@ -53,44 +91,154 @@ public:
         checkCompileErrors(fragment, "FRAGMENT");
 
         ID = glCreateProgram();
+        if (cache)
+            glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
         glAttachShader(ID, vertex);
         glAttachShader(ID, fragment);
         glLinkProgram(ID);
         checkCompileErrors(ID, "PROGRAM");
 
+        GLint linked = 0;
+        glGetProgramiv(ID, GL_LINK_STATUS, &linked);
+        if (cache && linked)
+            cache->store(cacheKey, ID);
+
         glDeleteShader(vertex);
         glDeleteShader(fragment);
+
+        reflect();
     }
 
+    // Through glStateCache, like the setters below: binding the program
+    // that is already bound, or setting a uniform of the bound program to
+    // the value it has, never reaches the driver.
     void use() {
-        glUseProgram(ID);
+        glStateCache::useProgram(ID);
     }
 
     void unuse() const {
-        glUseProgram(0);
+        glStateCache::useProgram(0);
+    }
+
+    // Cached location of an active uniform, -1 if the program has none by
+    // that name. Look it up once and keep the handle, the name overloads of
+    // the setters below search the reflected list on every call.
+    GLint getUniformLocation(const char* name) const {
+        for (const Uniform& uniform : uniforms) {
+            if (uniform.name == name)
+                return uniform.location;
+        }
+        return -1;
+    }
+
+    const std::vector<Uniform>& getUniforms() const {
+        return uniforms;
+    }
+
+    const UniformBlock* getUniformBlock(const char* name) const {
+        for (const UniformBlock& block : uniformBlocks) {
+            if (block.name == name)
+                return &block;
+        }
+        return nullptr;
     }
 
-    void setBool(const std::string& name, bool value) const {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+    void setBool(GLint location, bool value) const {
+        glStateCache::uniform1i(location, (int)value);
     }
 
-    void setInt(const std::string& name, int value) const {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+    void setInt(GLint location, int value) const {
+        glStateCache::uniform1i(location, value);
     }
 
-    void setFloat(const std::string& name, float value) const {
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+    void setFloat(GLint location, float value) const {
+        glStateCache::uniform1f(location, value);
     }
 
-    void setVec3(const std::string& name, const glm::vec3& value) const {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    void setVec3(GLint location, const glm::vec3& value) const {
+        glStateCache::uniform3fv(location, &value[0]);
     }
 
-    void setMat4(const std::string& name, const glm::mat4& mat) const {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    void setMat4(GLint location, const glm::mat4& mat) const {
+        glStateCache::uniformMatrix4fv(location, &mat[0][0]);
+    }
+
+    void setBool(const char* name, bool value) const {
+        setBool(getUniformLocation(name), value);
+    }
+
+    void setInt(const char* name, int value) const {
+        setInt(getUniformLocation(name), value);
+    }
+
+    void setFloat(const char* name, float value) const {
+        setFloat(getUniformLocation(name), value);
+    }
+
+    void setVec3(const char* name, const glm::vec3& value) const {
+        setVec3(getUniformLocation(name), value);
+    }
+
+    void setMat4(const char* name, const glm::mat4& mat) const {
+        setMat4(getUniformLocation(name), mat);
     }
 
 private:
+    std::vector<Uniform> uniforms;
+    std::vector<UniformBlock> uniformBlocks;
+
+    static void injectDefines(std::string& code, const char* defines) {
+        if (!defines || !*defines)
+            return;
+        std::size_t version = code.find("#version");
+        std::size_t lineEnd = version == std::string::npos ? std::string::npos : code.find('\n', version);
+        std::string block = defines;
+        if (block.back() != '\n')
+            block += '\n';
+        if (lineEnd == std::string::npos)
+            code.insert(0, block);
+        else
+            code.insert(lineEnd + 1, block);
+    }
+
+    void reflect() {
+        GLint count = 0;
+        GLint maxLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<char> name(maxLength > 0 ? maxLength : 1);
+        for (GLint i = 0; i < count; ++i) {
+            Uniform uniform;
+            GLsizei length = 0;
+            glGetActiveUniform(ID, i, (GLsizei)name.size(), &length, &uniform.size, &uniform.type, name.data());
+            uniform.name.assign(name.data(), length);
+            // Members of uniform blocks have no location
+            uniform.location = glGetUniformLocation(ID, uniform.name.c_str());
+            if (uniform.location < 0)
+                continue;
+            std::size_t bracket = uniform.name.find('[');
+            if (bracket != std::string::npos)
+                uniform.name.resize(bracket);
+            uniforms.push_back(uniform);
+        }
+
+        count = 0;
+        maxLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxLength);
+        name.resize(maxLength > 0 ? maxLength : 1);
+        for (GLint i = 0; i < count; ++i) {
+            UniformBlock block;
+            GLsizei length = 0;
+            glGetActiveUniformBlockName(ID, i, (GLsizei)name.size(), &length, name.data());
+            block.name.assign(name.data(), length);
+            block.index = i;
+            glGetActiveUniformBlockiv(ID, i, GL_UNIFORM_BLOCK_BINDING, &block.binding);
+            glGetActiveUniformBlockiv(ID, i, GL_UNIFORM_BLOCK_DATA_SIZE, &block.dataSize);
+            uniformBlocks.push_back(block);
+        }
+    }
+
     void checkCompileErrors(unsigned int shader, std::string type) {
         int success;
         char infoLog[1024];
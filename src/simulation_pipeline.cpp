@@ -0,0 +1,91 @@
+#include "simulation_pipeline.hpp"
+
+#include <chrono>
+
+#include "alloc_tracker.hpp"
+#include "cpu_profiler.hpp"
+#include "frame_arena.hpp"
+#include "particle_system.hpp"
+
+SimulationPipeline::SimulationPipeline(ParticleSystem &particleSystem)
+    : particleSystem(particleSystem) {
+  thread = std::thread(&SimulationPipeline::run, this);
+}
+
+SimulationPipeline::~SimulationPipeline() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  thread.join();
+}
+
+const ParticleFrame &SimulationPipeline::acquire() {
+  std::unique_lock<std::mutex> lock(mutex);
+  wake.wait(lock, [this] { return stepDone; });
+
+  // The finished step wrote into writeIndex; render from it and let the next
+  // step reuse the frame that was just drawn.
+  if (frameReady) {
+    frameReady = false;
+    renderIndex = writeIndex;
+    writeIndex = 1 - renderIndex;
+  }
+  return frames[renderIndex];
+}
+
+void SimulationPipeline::submit(float deltaTime,
+                                const glm::vec3 &cameraPosition) {
+  SimulationInput input;
+  input.deltaTime = deltaTime;
+  input.cameraPosition = cameraPosition;
+  inputs.write(input);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stepDone = false;
+    stepPending = true;
+  }
+  wake.notify_all();
+}
+
+float SimulationPipeline::getStepTime() const { return stepTime; }
+
+void SimulationPipeline::run() {
+  SimulationInput input;
+  FrameArena::local().setName("simulation");
+  cpuProfiler::setThreadName("simulation");
+
+  while (true) {
+    int target;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      wake.wait(lock, [this] { return stepPending || stopping; });
+      if (stopping)
+        return;
+      stepPending = false;
+      target = writeIndex;
+    }
+
+    inputs.read(input);
+
+    auto start = std::chrono::steady_clock::now();
+    {
+      ALLOC_SCOPE("simulation");
+      particleSystem.update(input.deltaTime, input.cameraPosition);
+      particleSystem.writeFrame(frames[target]);
+    }
+    FrameArena::local().reset();
+    stepTime = std::chrono::duration<float>(std::chrono::steady_clock::now() -
+                                            start)
+                   .count();
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stepDone = true;
+      frameReady = true;
+    }
+    wake.notify_all();
+  }
+}
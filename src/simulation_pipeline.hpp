@@ -0,0 +1,70 @@
+#ifndef SIMULATION_PIPELINE_HPP
+#define SIMULATION_PIPELINE_HPP
+
+#include "mailbox.hpp"
+#include "particle_frame.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <glm/glm.hpp>
+#include <mutex>
+#include <thread>
+
+class ParticleSystem;
+
+// Runs ParticleSystem::update() one frame ahead on its own thread. While the
+// GL thread draws frame N from one ParticleFrame, the simulation writes frame
+// N+1 into the other.
+//
+// Per GL frame:
+//   const ParticleFrame &frame = pipeline.acquire(); // frame N
+//   pipeline.submit(deltaTime, cameraPosition);      // starts frame N+1
+//   particleRenderer.render(frame, ...);
+//
+// Inputs travel through a lock-free mailbox; the mutex below only parks the
+// threads while there is nothing to do.
+class SimulationPipeline {
+public:
+  explicit SimulationPipeline(ParticleSystem &particleSystem);
+  ~SimulationPipeline();
+
+  SimulationPipeline(const SimulationPipeline &) = delete;
+  SimulationPipeline &operator=(const SimulationPipeline &) = delete;
+
+  // Waits for the step started by the last submit() and returns its frame.
+  // The frame stays valid until the next acquire().
+  const ParticleFrame &acquire();
+
+  // Hands the inputs for the next step to the simulation thread.
+  void submit(float deltaTime, const glm::vec3 &cameraPosition);
+
+  // Time the last step took on the simulation thread, in seconds.
+  float getStepTime() const;
+
+private:
+  struct SimulationInput {
+    float deltaTime = 0.0f;
+    glm::vec3 cameraPosition = glm::vec3(0.0f);
+  };
+
+  void run();
+
+  ParticleSystem &particleSystem;
+  Mailbox<SimulationInput> inputs;
+
+  ParticleFrame frames[2];
+  int renderIndex = 0;  // GL thread only
+  int writeIndex = 1;   // handed to the simulation thread with each submit
+
+  std::mutex mutex;
+  std::condition_variable wake;
+  bool stepPending = false;
+  bool stepDone = true;
+  bool frameReady = false;
+  bool stopping = false;
+
+  std::atomic<float> stepTime{0.0f};
+  std::thread thread;
+};
+
+#endif // SIMULATION_PIPELINE_HPP
@@ -0,0 +1,58 @@
+#include "static_batch.hpp"
+
+#include "gl_state_cache.hpp"
+
+void StaticBatch::add(const glm::vec3 *meshPositions, std::size_t meshVertices,
+                      const unsigned int *meshIndices, std::size_t meshIndexCount,
+                      const glm::mat4 &model) {
+  unsigned int base = static_cast<unsigned int>(positions.size());
+  for (std::size_t i = 0; i < meshVertices; ++i)
+    positions.push_back(glm::vec3(model * glm::vec4(meshPositions[i], 1.0f)));
+  for (std::size_t i = 0; i < meshIndexCount; ++i)
+    indices.push_back(base + meshIndices[i]);
+  ++meshCount;
+}
+
+void StaticBatch::build() {
+  vertexCount = positions.size();
+  indexCount = indices.size();
+
+  glGenVertexArrays(1, &vao);
+  glGenBuffers(1, &vertexBuffer);
+  glGenBuffers(1, &indexBuffer);
+  glStateCache::bindVertexArray(vao);
+  glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+  glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3),
+               positions.data(), GL_STATIC_DRAW);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int),
+               indices.data(), GL_STATIC_DRAW);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void *)0);
+  glEnableVertexAttribArray(0);
+  glStateCache::bindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  positions = std::vector<glm::vec3>();
+  indices = std::vector<unsigned int>();
+}
+
+void StaticBatch::draw(GLenum mode) const {
+  if (!indexCount)
+    return;
+  glStateCache::bindVertexArray(vao);
+  glDrawElements(mode, static_cast<GLsizei>(indexCount), GL_UNSIGNED_INT, 0);
+}
+
+std::size_t StaticBatch::getMeshCount() const { return meshCount; }
+
+std::size_t StaticBatch::getVertexCount() const { return vertexCount; }
+
+std::size_t StaticBatch::getIndexCount() const { return indexCount; }
+
+void StaticBatch::release() {
+  glStateCache::deleteVertexArrays(1, &vao);
+  glDeleteBuffers(1, &vertexBuffer);
+  glDeleteBuffers(1, &indexBuffer);
+  vao = vertexBuffer = indexBuffer = 0;
+  indexCount = 0;
+}
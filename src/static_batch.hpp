@@ -0,0 +1,47 @@
+#ifndef STATIC_BATCH_HPP
+#define STATIC_BATCH_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <vector>
+
+// Geometry that never moves, merged into one vertex and index buffer at
+// startup and drawn with a single call. Meshes are transformed on the CPU as
+// they are added, so the draw needs no per-mesh uniforms and costs the same
+// however many props went in. Positions only, at attribute location 0.
+class StaticBatch {
+public:
+  StaticBatch() = default;
+  StaticBatch(const StaticBatch &) = delete;
+  StaticBatch &operator=(const StaticBatch &) = delete;
+
+  // Appends a copy of the mesh placed by model. Only before build().
+  void add(const glm::vec3 *positions, std::size_t vertexCount,
+           const unsigned int *indices, std::size_t indexCount,
+           const glm::mat4 &model = glm::mat4(1.0f));
+
+  // Uploads the merged mesh and frees the CPU copy.
+  void build();
+
+  void draw(GLenum mode = GL_TRIANGLES) const;
+
+  std::size_t getMeshCount() const;
+  std::size_t getVertexCount() const;
+  std::size_t getIndexCount() const;
+
+  void release();
+
+private:
+  std::vector<glm::vec3> positions;
+  std::vector<unsigned int> indices;
+  std::size_t meshCount = 0;
+  std::size_t vertexCount = 0;
+  std::size_t indexCount = 0;
+
+  GLuint vao = 0;
+  GLuint vertexBuffer = 0;
+  GLuint indexBuffer = 0;
+};
+
+#endif // STATIC_BATCH_HPP
@@ -0,0 +1,172 @@
+#include "stream_buffer.hpp"
+
+#include "gl_call_tracker.hpp"
+
+#include <cassert>
+#include <chrono>
+#include <iostream>
+
+namespace {
+
+std::size_t roundUp(std::size_t value, std::size_t multiple) {
+  return (value + multiple - 1) / multiple * multiple;
+}
+
+} // namespace
+
+StreamBuffer::StreamBuffer(GLenum target, std::size_t regionSize,
+                           std::size_t alignment, int regionCount)
+    : target(target), alignment(alignment ? alignment : 1),
+      regionCount(regionCount < 1            ? 1
+                  : regionCount > maxRegions ? maxRegions
+                                             : regionCount),
+      persistent(GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage) {
+  if (!persistent)
+    std::cerr << "Buffer storage unavailable, streaming through glBufferData"
+              << std::endl;
+  allocate(regionSize);
+}
+
+void StreamBuffer::allocate(std::size_t size) {
+  regionSize = roundUp(size ? size : alignment, alignment);
+
+  glGenBuffers(1, &buffer);
+  glBindBuffer(target, buffer);
+  if (persistent) {
+    const GLbitfield flags =
+        GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    GLsizeiptr bytes = static_cast<GLsizeiptr>(regionSize * regionCount);
+    glBufferStorage(target, bytes, nullptr, flags);
+    mapped = static_cast<unsigned char *>(
+        glMapBufferRange(target, 0, bytes, flags));
+  } else {
+    glBufferData(target, static_cast<GLsizeiptr>(regionSize), nullptr,
+                 GL_STREAM_DRAW);
+  }
+  glBindBuffer(target, 0);
+  region = 0;
+  used = 0;
+  offset = 0;
+}
+
+void StreamBuffer::waitForRegion(int index) {
+  GLsync fence = fences[index];
+  if (!fence)
+    return;
+  fences[index] = nullptr;
+
+  GLenum status = glClientWaitSync(fence, 0, 0);
+  if (status == GL_TIMEOUT_EXPIRED) {
+    ++stats.stalls;
+    auto start = std::chrono::steady_clock::now();
+    do {
+      status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                1000000000); // 1 s
+    } while (status == GL_TIMEOUT_EXPIRED);
+    stats.stallSeconds += std::chrono::duration<double>(
+                              std::chrono::steady_clock::now() - start)
+                              .count();
+  }
+  if (status == GL_WAIT_FAILED)
+    std::cerr << "Stream buffer fence wait failed" << std::endl;
+  glDeleteSync(fence);
+}
+
+void StreamBuffer::beginFrame() {
+  assert(!inFrame && "StreamBuffer::beginFrame() without endFrame()");
+  inFrame = true;
+  ++stats.frames;
+  used = 0;
+  if (persistent)
+    waitForRegion(region);
+}
+
+bool StreamBuffer::fits(std::size_t bytes) const {
+  // Without persistence every map() orphans what the last one wrote.
+  if (!persistent)
+    return !used && bytes <= regionSize;
+  return roundUp(used, alignment) + bytes <= regionSize;
+}
+
+void *StreamBuffer::map(std::size_t bytes) {
+  assert(inFrame && "StreamBuffer::map() outside beginFrame()/endFrame()");
+
+  std::size_t needed = persistent ? roundUp(used, alignment) + bytes : bytes;
+  if (needed > regionSize) {
+    // Deleting the old store is deferred by GL until the draws that read it
+    // are done, and its fences go with it, so nothing waits here. The rest
+    // of the frame continues in region 0 of the new store.
+    release();
+    allocate(needed + needed / 2);
+    ++stats.reallocations;
+  }
+
+  if (!persistent) {
+    offset = 0;
+    glBindBuffer(target, buffer);
+    void *pointer = glMapBufferRange(
+        target, 0, static_cast<GLsizeiptr>(regionSize),
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    glBindBuffer(target, 0);
+    return pointer;
+  }
+
+  offset = region * regionSize + roundUp(used, alignment);
+  used = offset - region * regionSize + bytes;
+  return mapped + offset;
+}
+
+void StreamBuffer::unmap(std::size_t bytesWritten) {
+  // The caller's writes into the mapping are the upload; no GL call shows
+  // them.
+  glCallTracker::countUpload(bytesWritten);
+
+  // Coherent mapping: the writes are visible to commands issued after this
+  // point.
+  if (persistent) {
+    used = offset - region * regionSize + bytesWritten;
+  } else {
+    used = bytesWritten;
+    glBindBuffer(target, buffer);
+    glUnmapBuffer(target);
+    glBindBuffer(target, 0);
+  }
+}
+
+void StreamBuffer::endFrame() {
+  assert(inFrame && "StreamBuffer::endFrame() without beginFrame()");
+  inFrame = false;
+  if (!persistent || !used)
+    return;
+  // Issued after the frame's last draw from the region, so it signals once
+  // the GPU is done reading it.
+  fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  region = (region + 1) % regionCount;
+}
+
+GLuint StreamBuffer::getBuffer() const { return buffer; }
+
+std::size_t StreamBuffer::getOffset() const { return offset; }
+
+bool StreamBuffer::isPersistent() const { return persistent; }
+
+const StreamBuffer::Stats &StreamBuffer::getStats() const { return stats; }
+
+void StreamBuffer::release() {
+  for (int i = 0; i < regionCount; ++i) {
+    if (fences[i]) {
+      glDeleteSync(fences[i]);
+      fences[i] = nullptr;
+    }
+  }
+  if (!buffer)
+    return;
+  if (mapped) {
+    glBindBuffer(target, buffer);
+    glUnmapBuffer(target);
+    glBindBuffer(target, 0);
+    mapped = nullptr;
+  }
+  glDeleteBuffers(1, &buffer);
+  buffer = 0;
+}
@@ -0,0 +1,84 @@
+#ifndef STREAM_BUFFER_HPP
+#define STREAM_BUFFER_HPP
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+
+// Ring of regions in one persistently mapped buffer (GL 4.4 buffer storage,
+// PERSISTENT | COHERENT) for data rewritten every frame. Each frame owns one
+// region: beginFrame() waits until the GPU is done with it, map() hands out
+// aligned pieces of it for as many draws as the frame has, and endFrame()
+// fences it after the last of them. With three regions the CPU can fill one
+// while the GPU still reads the other two, and nothing is copied by the
+// driver.
+//
+// All calls need the GL context; a pointer returned by map() may be written
+// from any thread until unmap(). Without buffer storage every map() orphans
+// the buffer and maps it with glMapBufferRange instead.
+class StreamBuffer {
+public:
+  struct Stats {
+    std::uint64_t frames = 0;
+    // Frames where the region was still in use and beginFrame() had to wait.
+    std::uint64_t stalls = 0;
+    double stallSeconds = 0.0;
+    std::uint64_t reallocations = 0;
+  };
+
+  // Pieces start at multiples of alignment, so offsets can double as a
+  // base instance or vertex when alignment is the record size.
+  StreamBuffer(GLenum target, std::size_t regionSize,
+               std::size_t alignment = 1, int regionCount = 3);
+
+  StreamBuffer(const StreamBuffer &) = delete;
+  StreamBuffer &operator=(const StreamBuffer &) = delete;
+
+  void beginFrame();
+  // Returns bytes of writable memory after the pieces already handed out
+  // this frame. When the region is full the buffer grows (changing
+  // getBuffer()) without waiting: GL keeps the old store alive for the draws
+  // already issued from it.
+  void *map(std::size_t bytes);
+  // Before any draw that reads the last map(). Only the first bytesWritten
+  // are kept; the next map() follows right after them.
+  void unmap(std::size_t bytesWritten);
+  void endFrame();
+
+  // Whether map(bytes) leaves the memory handed out earlier this frame in
+  // place, for draws from it that are not issued yet.
+  bool fits(std::size_t bytes) const;
+
+  GLuint getBuffer() const;
+  // Byte offset in getBuffer() of the last map().
+  std::size_t getOffset() const;
+  bool isPersistent() const;
+  const Stats &getStats() const;
+
+  void release();
+
+private:
+  static constexpr int maxRegions = 4;
+
+  void allocate(std::size_t regionSize);
+  void waitForRegion(int region);
+
+  GLenum target;
+  std::size_t alignment;
+  int regionCount;
+  bool persistent;
+
+  GLuint buffer = 0;
+  std::size_t regionSize = 0;
+  unsigned char *mapped = nullptr;
+  GLsync fences[maxRegions] = {};
+  int region = 0;
+  // Bytes of the current region handed out this frame.
+  std::size_t used = 0;
+  std::size_t offset = 0;
+  bool inFrame = false;
+
+  Stats stats;
+};
+
+#endif // STREAM_BUFFER_HPP
@@ -0,0 +1,437 @@
+#include "texture_codec.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+namespace textureCodec {
+
+namespace {
+
+bool isCompressed(GLenum format) {
+  return format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+}
+
+std::size_t levelSize(GLenum format, int width, int height) {
+  if (isCompressed(format))
+    return static_cast<std::size_t>((width + 3) / 4) * ((height + 3) / 4) * 16;
+  return static_cast<std::size_t>(width) * height * 4;
+}
+
+// Offsets and sizes for a full chain of the given format, data left empty.
+MipChain layoutChain(GLenum format, int width, int height, int levelCount) {
+  MipChain chain;
+  chain.format = format;
+  std::size_t offset = 0;
+  for (int level = 0; level < levelCount; ++level) {
+    std::size_t size = levelSize(format, width, height);
+    chain.levels.push_back({width, height, offset, size});
+    offset += size;
+    width = std::max(1, width / 2);
+    height = std::max(1, height / 2);
+  }
+  chain.data.resize(offset);
+  return chain;
+}
+
+int fullLevelCount(int width, int height) {
+  int levels = 1;
+  while (width > 1 || height > 1) {
+    width = std::max(1, width / 2);
+    height = std::max(1, height / 2);
+    ++levels;
+  }
+  return levels;
+}
+
+void downsample(const unsigned char *source, int width, int height,
+                unsigned char *target) {
+  int targetWidth = std::max(1, width / 2);
+  int targetHeight = std::max(1, height / 2);
+  for (int y = 0; y < targetHeight; ++y) {
+    int y0 = std::min(y * 2, height - 1);
+    int y1 = std::min(y * 2 + 1, height - 1);
+    for (int x = 0; x < targetWidth; ++x) {
+      int x0 = std::min(x * 2, width - 1);
+      int x1 = std::min(x * 2 + 1, width - 1);
+      for (int c = 0; c < 4; ++c) {
+        int sum = source[(y0 * width + x0) * 4 + c] +
+                  source[(y0 * width + x1) * 4 + c] +
+                  source[(y1 * width + x0) * 4 + c] +
+                  source[(y1 * width + x1) * 4 + c];
+        target[(y * targetWidth + x) * 4 + c] =
+            static_cast<unsigned char>((sum + 2) / 4);
+      }
+    }
+  }
+}
+
+void compressLevel(const unsigned char *rgba, int width, int height,
+                   unsigned char *blocks) {
+  unsigned char texels[64];
+  for (int by = 0; by < height; by += 4) {
+    for (int bx = 0; bx < width; bx += 4) {
+      // Edge blocks repeat the last row/column.
+      for (int y = 0; y < 4; ++y) {
+        int sy = std::min(by + y, height - 1);
+        for (int x = 0; x < 4; ++x) {
+          int sx = std::min(bx + x, width - 1);
+          std::memcpy(texels + (y * 4 + x) * 4, rgba + (sy * width + sx) * 4, 4);
+        }
+      }
+      encodeBc3Block(texels, blocks);
+      blocks += 16;
+    }
+  }
+}
+
+std::uint16_t packRgb565(const int rgb[3]) {
+  int r = (rgb[0] * 31 + 127) / 255;
+  int g = (rgb[1] * 63 + 127) / 255;
+  int b = (rgb[2] * 31 + 127) / 255;
+  return static_cast<std::uint16_t>(r << 11 | g << 5 | b);
+}
+
+void unpackRgb565(std::uint16_t color, int rgb[3]) {
+  int r = (color >> 11) & 31;
+  int g = (color >> 5) & 63;
+  int b = color & 31;
+  rgb[0] = r << 3 | r >> 2;
+  rgb[1] = g << 2 | g >> 4;
+  rgb[2] = b << 3 | b >> 2;
+}
+
+// BC3 alpha palette; a0 > a1 selects eight interpolated values, otherwise
+// six plus 0 and 255.
+void alphaPalette(int a0, int a1, int palette[8]) {
+  palette[0] = a0;
+  palette[1] = a1;
+  if (a0 > a1) {
+    for (int k = 2; k < 8; ++k)
+      palette[k] = ((8 - k) * a0 + (k - 1) * a1) / 7;
+  } else {
+    for (int k = 2; k < 6; ++k)
+      palette[k] = ((6 - k) * a0 + (k - 1) * a1) / 5;
+    palette[6] = 0;
+    palette[7] = 255;
+  }
+}
+
+void colorPalette(std::uint16_t c0, std::uint16_t c1, int palette[4][3]) {
+  unpackRgb565(c0, palette[0]);
+  unpackRgb565(c1, palette[1]);
+  for (int c = 0; c < 3; ++c) {
+    if (c0 > c1) {
+      palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+      palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    } else {
+      palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+      palette[3][c] = 0;
+    }
+  }
+}
+
+void encodeAlpha(const unsigned char *texels, unsigned char *block) {
+  int low = 255, high = 0;
+  for (int i = 0; i < 16; ++i) {
+    low = std::min<int>(low, texels[i * 4 + 3]);
+    high = std::max<int>(high, texels[i * 4 + 3]);
+  }
+  block[0] = static_cast<unsigned char>(high);
+  block[1] = static_cast<unsigned char>(low);
+
+  std::uint64_t indices = 0;
+  if (high > low) {
+    int palette[8];
+    alphaPalette(high, low, palette);
+    for (int i = 0; i < 16; ++i) {
+      int alpha = texels[i * 4 + 3];
+      int best = 0;
+      for (int k = 1; k < 8; ++k)
+        if (std::abs(palette[k] - alpha) < std::abs(palette[best] - alpha))
+          best = k;
+      indices |= static_cast<std::uint64_t>(best) << (3 * i);
+    }
+  }
+  for (int b = 0; b < 6; ++b)
+    block[2 + b] = static_cast<unsigned char>(indices >> (8 * b));
+}
+
+void encodeColor(const unsigned char *texels, unsigned char *block) {
+  // Fully transparent texels do not show, so they do not get a say in the
+  // endpoints unless the whole block is transparent.
+  bool used[16];
+  int usedCount = 0;
+  for (int i = 0; i < 16; ++i) {
+    used[i] = texels[i * 4 + 3] > 0;
+    usedCount += used[i];
+  }
+  if (!usedCount)
+    std::fill(used, used + 16, true);
+
+  int low[3] = {255, 255, 255}, high[3] = {0, 0, 0};
+  float mean[3] = {0.0f, 0.0f, 0.0f};
+  int count = 0;
+  for (int i = 0; i < 16; ++i) {
+    if (!used[i])
+      continue;
+    for (int c = 0; c < 3; ++c) {
+      low[c] = std::min<int>(low[c], texels[i * 4 + c]);
+      high[c] = std::max<int>(high[c], texels[i * 4 + c]);
+      mean[c] += texels[i * 4 + c];
+    }
+    ++count;
+  }
+  for (int c = 0; c < 3; ++c)
+    mean[c] /= count;
+
+  // Bounding box diagonal, with the axes that fall while the widest channel
+  // rises flipped so the endpoints follow the colour gradient.
+  int widest = 0;
+  for (int c = 1; c < 3; ++c)
+    if (high[c] - low[c] > high[widest] - low[widest])
+      widest = c;
+  for (int c = 0; c < 3; ++c) {
+    if (c == widest)
+      continue;
+    float covariance = 0.0f;
+    for (int i = 0; i < 16; ++i)
+      if (used[i])
+        covariance += (texels[i * 4 + c] - mean[c]) *
+                      (texels[i * 4 + widest] - mean[widest]);
+    if (covariance < 0.0f)
+      std::swap(low[c], high[c]);
+  }
+  // Pull the ends in by 1/16 of the range; the box corners overshoot.
+  for (int c = 0; c < 3; ++c) {
+    int inset = (high[c] - low[c]) / 16;
+    high[c] -= inset;
+    low[c] += inset;
+  }
+
+  std::uint16_t c0 = packRgb565(high);
+  std::uint16_t c1 = packRgb565(low);
+  if (c0 < c1)
+    std::swap(c0, c1);
+
+  std::uint32_t indices = 0;
+  if (c0 != c1) {
+    int palette[4][3];
+    colorPalette(c0, c1, palette);
+    for (int i = 0; i < 16; ++i) {
+      int best = 0, bestDistance = 1 << 30;
+      for (int k = 0; k < 4; ++k) {
+        int distance = 0;
+        for (int c = 0; c < 3; ++c) {
+          int d = palette[k][c] - texels[i * 4 + c];
+          distance += d * d;
+        }
+        if (distance < bestDistance) {
+          bestDistance = distance;
+          best = k;
+        }
+      }
+      indices |= static_cast<std::uint32_t>(best) << (2 * i);
+    }
+  }
+
+  block[0] = static_cast<unsigned char>(c0);
+  block[1] = static_cast<unsigned char>(c0 >> 8);
+  block[2] = static_cast<unsigned char>(c1);
+  block[3] = static_cast<unsigned char>(c1 >> 8);
+  for (int b = 0; b < 4; ++b)
+    block[4 + b] = static_cast<unsigned char>(indices >> (8 * b));
+}
+
+void decodeBc3Block(const unsigned char *block, unsigned char *texels) {
+  int alphas[8];
+  alphaPalette(block[0], block[1], alphas);
+  std::uint64_t alphaIndices = 0;
+  for (int b = 0; b < 6; ++b)
+    alphaIndices |= static_cast<std::uint64_t>(block[2 + b]) << (8 * b);
+
+  std::uint16_t c0 = static_cast<std::uint16_t>(block[8] | block[9] << 8);
+  std::uint16_t c1 = static_cast<std::uint16_t>(block[10] | block[11] << 8);
+  int colors[4][3];
+  colorPalette(c0, c1, colors);
+  std::uint32_t colorIndices = 0;
+  for (int b = 0; b < 4; ++b)
+    colorIndices |= static_cast<std::uint32_t>(block[12 + b]) << (8 * b);
+
+  for (int i = 0; i < 16; ++i) {
+    const int *color = colors[(colorIndices >> (2 * i)) & 3];
+    for (int c = 0; c < 3; ++c)
+      texels[i * 4 + c] = static_cast<unsigned char>(color[c]);
+    texels[i * 4 + 3] =
+        static_cast<unsigned char>(alphas[(alphaIndices >> (3 * i)) & 7]);
+  }
+}
+
+// DDS layout, see the DirectX "DDS_HEADER" documentation.
+struct DdsPixelFormat {
+  std::uint32_t size;
+  std::uint32_t flags;
+  std::uint32_t fourCC;
+  std::uint32_t rgbBitCount;
+  std::uint32_t redMask;
+  std::uint32_t greenMask;
+  std::uint32_t blueMask;
+  std::uint32_t alphaMask;
+};
+
+struct DdsHeader {
+  std::uint32_t size;
+  std::uint32_t flags;
+  std::uint32_t height;
+  std::uint32_t width;
+  std::uint32_t pitchOrLinearSize;
+  std::uint32_t depth;
+  std::uint32_t mipMapCount;
+  std::uint32_t reserved1[11];
+  DdsPixelFormat format;
+  std::uint32_t caps;
+  std::uint32_t caps2;
+  std::uint32_t caps3;
+  std::uint32_t caps4;
+  std::uint32_t reserved2;
+};
+static_assert(sizeof(DdsHeader) == 124, "DDS header layout");
+
+const char ddsMagic[4] = {'D', 'D', 'S', ' '};
+const std::uint32_t fourCCDxt5 = 'D' | 'X' << 8 | 'T' << 16 | '5' << 24;
+
+const std::uint32_t ddsdCaps = 0x1;
+const std::uint32_t ddsdHeight = 0x2;
+const std::uint32_t ddsdWidth = 0x4;
+const std::uint32_t ddsdPitch = 0x8;
+const std::uint32_t ddsdPixelFormat = 0x1000;
+const std::uint32_t ddsdMipMapCount = 0x20000;
+const std::uint32_t ddsdLinearSize = 0x80000;
+const std::uint32_t ddpfAlphaPixels = 0x1;
+const std::uint32_t ddpfFourCC = 0x4;
+const std::uint32_t ddpfRgb = 0x40;
+const std::uint32_t ddsCapsComplex = 0x8;
+const std::uint32_t ddsCapsTexture = 0x1000;
+const std::uint32_t ddsCapsMipMap = 0x400000;
+
+} // namespace
+
+MipChain buildMipChain(const unsigned char *rgba, int width, int height,
+                       bool compress) {
+  GLenum format = compress ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_RGBA8;
+  MipChain chain =
+      layoutChain(format, width, height, fullLevelCount(width, height));
+
+  std::vector<unsigned char> current(rgba, rgba + std::size_t(width) * height * 4);
+  std::vector<unsigned char> next;
+  for (std::size_t level = 0; level < chain.levels.size(); ++level) {
+    const MipLevel &mip = chain.levels[level];
+    if (compress)
+      compressLevel(current.data(), mip.width, mip.height,
+                    chain.data.data() + mip.offset);
+    else
+      std::memcpy(chain.data.data() + mip.offset, current.data(), mip.size);
+
+    if (level + 1 < chain.levels.size()) {
+      const MipLevel &below = chain.levels[level + 1];
+      next.resize(std::size_t(below.width) * below.height * 4);
+      downsample(current.data(), mip.width, mip.height, next.data());
+      current.swap(next);
+    }
+  }
+  return chain;
+}
+
+void encodeBc3Block(const unsigned char *texels, unsigned char *block) {
+  encodeAlpha(texels, block);
+  encodeColor(texels, block + 8);
+}
+
+void decodeBc3(const unsigned char *blocks, int width, int height,
+               unsigned char *rgba) {
+  unsigned char texels[64];
+  for (int by = 0; by < height; by += 4) {
+    for (int bx = 0; bx < width; bx += 4) {
+      decodeBc3Block(blocks, texels);
+      blocks += 16;
+      for (int y = 0; y < 4 && by + y < height; ++y)
+        for (int x = 0; x < 4 && bx + x < width; ++x)
+          std::memcpy(rgba + ((by + y) * width + bx + x) * 4,
+                      texels + (y * 4 + x) * 4, 4);
+    }
+  }
+}
+
+bool writeDds(const std::string &path, const MipChain &chain) {
+  if (chain.levels.empty())
+    return false;
+
+  DdsHeader header = {};
+  header.size = sizeof(DdsHeader);
+  header.flags = ddsdCaps | ddsdHeight | ddsdWidth | ddsdPixelFormat |
+                 ddsdMipMapCount;
+  header.width = chain.levels[0].width;
+  header.height = chain.levels[0].height;
+  header.mipMapCount = static_cast<std::uint32_t>(chain.levels.size());
+  header.format.size = sizeof(DdsPixelFormat);
+  if (isCompressed(chain.format)) {
+    header.flags |= ddsdLinearSize;
+    header.pitchOrLinearSize = static_cast<std::uint32_t>(chain.levels[0].size);
+    header.format.flags = ddpfFourCC;
+    header.format.fourCC = fourCCDxt5;
+  } else {
+    header.flags |= ddsdPitch;
+    header.pitchOrLinearSize = header.width * 4;
+    header.format.flags = ddpfRgb | ddpfAlphaPixels;
+    header.format.rgbBitCount = 32;
+    header.format.redMask = 0x000000ff;
+    header.format.greenMask = 0x0000ff00;
+    header.format.blueMask = 0x00ff0000;
+    header.format.alphaMask = 0xff000000;
+  }
+  header.caps = ddsCapsTexture | ddsCapsMipMap | ddsCapsComplex;
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(ddsMagic, 4);
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char *>(chain.data.data()),
+             static_cast<std::streamsize>(chain.data.size()));
+  return static_cast<bool>(file);
+}
+
+bool readDds(const std::string &path, MipChain &chain) {
+  std::ifstream file(path, std::ios::binary);
+  char magic[4];
+  DdsHeader header;
+  if (!file.read(magic, 4) || !std::equal(magic, magic + 4, ddsMagic) ||
+      !file.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+      header.size != sizeof(DdsHeader) || !header.width || !header.height ||
+      header.width > 16384 || header.height > 16384)
+    return false;
+
+  GLenum format;
+  if (header.format.flags & ddpfFourCC && header.format.fourCC == fourCCDxt5)
+    format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+  else if (header.format.flags & ddpfRgb && header.format.rgbBitCount == 32 &&
+           header.format.redMask == 0x000000ff)
+    format = GL_RGBA8;
+  else
+    return false;
+
+  int width = static_cast<int>(header.width);
+  int height = static_cast<int>(header.height);
+  int levels = static_cast<int>(header.mipMapCount);
+  if (levels < 1 || levels > fullLevelCount(width, height))
+    return false;
+
+  MipChain loaded = layoutChain(format, width, height, levels);
+  if (!file.read(reinterpret_cast<char *>(loaded.data.data()),
+                 static_cast<std::streamsize>(loaded.data.size())))
+    return false;
+  chain = std::move(loaded);
+  return true;
+}
+
+} // namespace textureCodec
@@ -0,0 +1,46 @@
+#ifndef TEXTURE_CODEC_HPP
+#define TEXTURE_CODEC_HPP
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// CPU side of texture loading: mip chain generation, BC3 (DXT5) block
+// compression and the DDS files the texture cache keeps. Nothing in here
+// calls GL, so all of it runs on the loader threads.
+namespace textureCodec {
+
+struct MipLevel {
+  int width;
+  int height;
+  // Byte range in MipChain::data
+  std::size_t offset;
+  std::size_t size;
+};
+
+struct MipChain {
+  // GL_RGBA8 or GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+  GLenum format = GL_RGBA8;
+  std::vector<MipLevel> levels;
+  std::vector<unsigned char> data;
+};
+
+// Every level down to 1x1 from RGBA8 texels using a 2x2 box filter, each one
+// BC3 compressed when compress is set.
+MipChain buildMipChain(const unsigned char *rgba, int width, int height,
+                       bool compress);
+
+// texels: 4x4 RGBA8, row by row. block: 16 bytes of BC3.
+void encodeBc3Block(const unsigned char *texels, unsigned char *block);
+// Expands a BC3 level of width x height back to RGBA8.
+void decodeBc3(const unsigned char *blocks, int width, int height,
+               unsigned char *rgba);
+
+// Only DDS files written by writeDds are understood by readDds.
+bool writeDds(const std::string &path, const MipChain &chain);
+bool readDds(const std::string &path, MipChain &chain);
+
+} // namespace textureCodec
+
+#endif // TEXTURE_CODEC_HPP
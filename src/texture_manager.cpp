@@ -0,0 +1,295 @@
+#include "texture_manager.hpp"
+
+#include "cpu_profiler.hpp"
+#include "disk_cache.hpp"
+#include "gl_state_cache.hpp"
+#include <stb_image/stb_image.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+namespace {
+
+// Bump when the codec output changes so old cache entries miss.
+const std::uint64_t cacheVersion = 1;
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+} // namespace
+
+TextureManager::TextureManager(const std::string &cacheDirectory,
+                               int workerCount)
+    : cacheDirectory(cacheDirectory),
+      compress(GLAD_GL_EXT_texture_compression_s3tc != 0) {
+  if (!this->cacheDirectory.empty()) {
+    std::error_code error;
+    std::filesystem::create_directories(this->cacheDirectory, error);
+    if (error) {
+      std::cerr << "Texture cache: cannot create " << cacheDirectory << ": "
+                << error.message() << std::endl;
+      this->cacheDirectory.clear();
+    }
+  }
+
+  if (workerCount <= 0)
+    workerCount = static_cast<int>(
+        std::clamp(std::thread::hardware_concurrency() / 2, 1u, 4u));
+  for (int i = 0; i < workerCount; ++i)
+    workers.emplace_back(&TextureManager::workerLoop, this);
+}
+
+TextureManager::~TextureManager() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  jobAvailable.notify_all();
+  for (std::thread &worker : workers)
+    worker.join();
+}
+
+void TextureManager::request(const std::string &path, bool keepPixels) {
+  std::unique_ptr<Entry> &entry = entries[path];
+  if (entry)
+    return;
+  entry = std::make_unique<Entry>();
+  entry->path = path;
+  entry->keepPixels = keepPixels;
+  ++stats.requested;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    jobs.push_back(entry.get());
+  }
+  jobAvailable.notify_one();
+}
+
+void TextureManager::update() {
+  std::deque<Entry *> ready;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    ready.swap(finished);
+  }
+  for (Entry *entry : ready)
+    upload(*entry);
+}
+
+GLuint TextureManager::get(const std::string &path) {
+  request(path);
+  Entry &entry = *entries[path];
+  while (!entry.done) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      jobFinished.wait(lock, [this] { return !finished.empty(); });
+    }
+    update();
+  }
+  return entry.texture;
+}
+
+const TextureManager::Pixels *
+TextureManager::getPixels(const std::string &path) const {
+  auto it = entries.find(path);
+  if (it == entries.end() || !it->second->done ||
+      it->second->pixels.rgba.empty())
+    return nullptr;
+  return &it->second->pixels;
+}
+
+void TextureManager::discardPixels(const std::string &path) {
+  auto it = entries.find(path);
+  if (it != entries.end() && it->second->done)
+    it->second->pixels = Pixels();
+}
+
+bool TextureManager::isCompressing() const { return compress; }
+
+const TextureManager::Stats &TextureManager::getStats() const { return stats; }
+
+void TextureManager::release() {
+  for (auto &item : entries) {
+    if (item.second->texture)
+      glStateCache::deleteTextures(1, &item.second->texture);
+    item.second->texture = 0;
+  }
+  if (uploadBuffer)
+    glDeleteBuffers(1, &uploadBuffer);
+  uploadBuffer = 0;
+  uploadBufferSize = 0;
+}
+
+void TextureManager::workerLoop() {
+  cpuProfiler::setThreadName("textures");
+  for (;;) {
+    Entry *entry;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      jobAvailable.wait(lock, [this] { return stopping || !jobs.empty(); });
+      if (stopping)
+        return;
+      entry = jobs.front();
+      jobs.pop_front();
+    }
+
+    load(*entry);
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      finished.push_back(entry);
+    }
+    jobFinished.notify_all();
+  }
+}
+
+void TextureManager::load(Entry &entry) const {
+  PROFILE_ZONE("TextureManager::load");
+  auto start = std::chrono::steady_clock::now();
+  GLenum format = compress ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_RGBA8;
+
+  std::string cached = cacheDirectory.empty() ? "" : cachePath(entry.path);
+  if (!cached.empty() && textureCodec::readDds(cached, entry.chain) &&
+      entry.chain.format == format) {
+    entry.fromCache = true;
+    if (entry.keepPixels) {
+      const textureCodec::MipLevel &base = entry.chain.levels[0];
+      entry.pixels.width = base.width;
+      entry.pixels.height = base.height;
+      entry.pixels.rgba.resize(std::size_t(base.width) * base.height * 4);
+      if (compress)
+        textureCodec::decodeBc3(entry.chain.data.data(), base.width,
+                                base.height, entry.pixels.rgba.data());
+      else
+        std::memcpy(entry.pixels.rgba.data(), entry.chain.data.data(),
+                    base.size);
+    }
+    entry.loadSeconds = secondsSince(start);
+    return;
+  }
+
+  int width, height, channels;
+  unsigned char *rgba =
+      stbi_load(entry.path.c_str(), &width, &height, &channels, 4);
+  if (!rgba) {
+    entry.failed = true;
+    entry.loadSeconds = secondsSince(start);
+    return;
+  }
+  entry.chain = textureCodec::buildMipChain(rgba, width, height, compress);
+  if (entry.keepPixels) {
+    entry.pixels.width = width;
+    entry.pixels.height = height;
+    entry.pixels.rgba.assign(rgba, rgba + std::size_t(width) * height * 4);
+  }
+  stbi_image_free(rgba);
+
+  if (!cached.empty()) {
+    diskCache::writeAtomically(cached, [&](const std::string &temporary) {
+      return textureCodec::writeDds(temporary, entry.chain);
+    });
+  }
+  entry.loadSeconds = secondsSince(start);
+}
+
+std::string TextureManager::cachePath(const std::string &path) const {
+  std::error_code error;
+  std::filesystem::path absolute = std::filesystem::absolute(path, error);
+  std::uintmax_t size = std::filesystem::file_size(path, error);
+  if (error)
+    return "";
+  auto modified =
+      std::filesystem::last_write_time(path, error).time_since_epoch().count();
+  if (error)
+    return "";
+
+  std::string name = absolute.string();
+  std::uint64_t key = diskCache::hash(name);
+  key = diskCache::hashValue(size, key);
+  key = diskCache::hashValue(modified, key);
+  key = diskCache::hashValue(compress, key);
+  key = diskCache::hashValue(cacheVersion, key);
+
+  char file[32];
+  std::snprintf(file, sizeof(file), "%016llx.dds",
+                static_cast<unsigned long long>(key));
+  return (std::filesystem::path(cacheDirectory) / file).string();
+}
+
+void TextureManager::upload(Entry &entry) {
+  entry.done = true;
+  stats.loadSeconds += entry.loadSeconds;
+  if (entry.failed) {
+    ++stats.failed;
+    std::cerr << "Failed to load texture: " << entry.path << std::endl;
+    return;
+  }
+  if (entry.fromCache)
+    ++stats.cacheHits;
+  else
+    ++stats.decoded;
+
+  auto start = std::chrono::steady_clock::now();
+  const textureCodec::MipChain &chain = entry.chain;
+
+  // Staged through one orphaned unpack buffer, so the copy into the texture
+  // is the driver's business and does not block here.
+  if (!uploadBuffer)
+    glGenBuffers(1, &uploadBuffer);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, uploadBuffer);
+  if (chain.data.size() > uploadBufferSize) {
+    uploadBufferSize = chain.data.size();
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, uploadBufferSize, nullptr,
+                 GL_STREAM_DRAW);
+  }
+  void *mapped =
+      glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, chain.data.size(),
+                       GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+  bool staged = mapped != nullptr;
+  if (staged) {
+    std::memcpy(mapped, chain.data.data(), chain.data.size());
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+  } else {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  }
+  // Offsets into the bound unpack buffer, or client memory without one.
+  auto source = [&](const textureCodec::MipLevel &mip) -> const void * {
+    if (staged)
+      return reinterpret_cast<const void *>(mip.offset);
+    return chain.data.data() + mip.offset;
+  };
+
+  const textureCodec::MipLevel &top = chain.levels[0];
+  glGenTextures(1, &entry.texture);
+  glStateCache::bindTexture(GL_TEXTURE_2D, entry.texture);
+  glTexStorage2D(GL_TEXTURE_2D, static_cast<GLsizei>(chain.levels.size()),
+                 chain.format, top.width, top.height);
+  for (std::size_t level = 0; level < chain.levels.size(); ++level) {
+    const textureCodec::MipLevel &mip = chain.levels[level];
+    if (chain.format == GL_RGBA8)
+      glTexSubImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), 0, 0,
+                      mip.width, mip.height, GL_RGBA, GL_UNSIGNED_BYTE,
+                      source(mip));
+    else
+      glCompressedTexSubImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), 0,
+                                0, mip.width, mip.height, chain.format,
+                                static_cast<GLsizei>(mip.size), source(mip));
+  }
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                  GL_LINEAR_MIPMAP_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+  ++stats.uploaded;
+  stats.uploadedBytes += chain.data.size();
+  stats.uploadSeconds += secondsSince(start);
+  entry.chain = textureCodec::MipChain();
+}
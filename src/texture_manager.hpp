@@ -0,0 +1,115 @@
+#ifndef TEXTURE_MANAGER_HPP
+#define TEXTURE_MANAGER_HPP
+
+#include "texture_codec.hpp"
+
+#include <glad/glad.h>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Loads 2D textures off the GL thread. request() queues a path for the
+// worker threads, which decode it, build the mip chain and BC3 compress it
+// (when the driver has S3TC); the GL thread then uploads it through a pixel
+// unpack buffer in update() or get(). Each path is loaded once, later
+// requests share the texture.
+//
+// The finished mip chain is kept as a DDS file in the cache directory, keyed
+// by path, size and modification time, so later runs skip decode, mip
+// generation and compression entirely.
+class TextureManager {
+public:
+  struct Stats {
+    unsigned int requested = 0;
+    unsigned int cacheHits = 0;
+    unsigned int decoded = 0;
+    unsigned int failed = 0;
+    unsigned int uploaded = 0;
+    std::size_t uploadedBytes = 0;
+    // Summed over the workers, so it can exceed wall time.
+    double loadSeconds = 0.0;
+    double uploadSeconds = 0.0;
+  };
+
+  struct Pixels {
+    int width = 0;
+    int height = 0;
+    // Level 0 as RGBA8
+    std::vector<unsigned char> rgba;
+  };
+
+  // An empty cacheDirectory disables the cache. workerCount 0 picks one
+  // from the core count.
+  explicit TextureManager(const std::string &cacheDirectory,
+                          int workerCount = 0);
+  ~TextureManager();
+
+  TextureManager(const TextureManager &) = delete;
+  TextureManager &operator=(const TextureManager &) = delete;
+
+  // Returns immediately. keepPixels (honoured on the first request of a
+  // path) keeps the level 0 texels around for getPixels().
+  void request(const std::string &path, bool keepPixels = false);
+
+  // Uploads whatever the workers have finished, without waiting.
+  void update();
+
+  // Texture for path, waiting for it to load if necessary; 0 if it failed.
+  GLuint get(const std::string &path);
+
+  // Level 0 texels of a loaded texture requested with keepPixels, else
+  // nullptr.
+  const Pixels *getPixels(const std::string &path) const;
+  void discardPixels(const std::string &path);
+
+  bool isCompressing() const;
+  const Stats &getStats() const;
+
+  // Deletes the textures and the upload buffer; needs the GL context.
+  void release();
+
+private:
+  struct Entry {
+    std::string path;
+    bool keepPixels = false;
+    // Written by a worker, read by the GL thread once the entry is finished.
+    textureCodec::MipChain chain;
+    Pixels pixels;
+    bool fromCache = false;
+    bool failed = false;
+    double loadSeconds = 0.0;
+    // GL thread only
+    bool done = false;
+    GLuint texture = 0;
+  };
+
+  void workerLoop();
+  void load(Entry &entry) const;
+  std::string cachePath(const std::string &path) const;
+  void upload(Entry &entry);
+
+  std::string cacheDirectory;
+  bool compress;
+
+  std::unordered_map<std::string, std::unique_ptr<Entry>> entries;
+
+  std::mutex mutex;
+  std::condition_variable jobAvailable;
+  std::condition_variable jobFinished;
+  std::deque<Entry *> jobs;
+  std::deque<Entry *> finished;
+  bool stopping = false;
+  std::vector<std::thread> workers;
+
+  GLuint uploadBuffer = 0;
+  std::size_t uploadBufferSize = 0;
+  Stats stats;
+};
+
+#endif // TEXTURE_MANAGER_HPP